@@ -1,5 +1,7 @@
 #include "config_portal.h"
 
+#include <string.h>
+
 #include "WiFi.h"
 
 // HTML for configuration page
@@ -13,7 +15,7 @@ static const char CONFIG_HTML[] PROGMEM = R"rawliteral(
     body { font-family: Arial, sans-serif; margin: 0; padding: 20px; }
     .form-group { margin-bottom: 15px; }
     label { display: block; margin-bottom: 5px; }
-    input[type="text"], input[type="password"] { width: 100%; padding: 8px; box-sizing: border-box; }
+    input[type="text"], input[type="password"], textarea { width: 100%; padding: 8px; box-sizing: border-box; }
     button { background-color: #4CAF50; color: white; padding: 10px 15px; border: none; cursor: pointer; }
     fieldset { margin-bottom: 20px; }
     .section { margin-bottom: 30px; }
@@ -43,6 +45,12 @@ static const char CONFIG_HTML[] PROGMEM = R"rawliteral(
           <label for="wifiPassword">WiFi Password:</label>
           <input type="password" id="wifiPassword" name="wifiPassword" value="%WIFI_PASSWORD%">
         </div>
+        <div class="form-group">
+          <label for="wifiCoexist">
+            <input type="checkbox" id="wifiCoexist" name="wifiCoexist" value="1" %WIFI_COEXIST%>
+            Keep WiFi connected (sensors follow the router's channel)
+          </label>
+        </div>
       </fieldset>
     </div>
 
@@ -53,6 +61,14 @@ static const char CONFIG_HTML[] PROGMEM = R"rawliteral(
           <label for="polynomial">Polynomial:</label>
           <input type="text" id="polynomial" name="polynomial" value="%POLYNOMIAL%">
         </div>
+        <div class="form-group">
+          <label for="sensorPolynomials">Per-sensor polynomials (one <code>name=polynomial</code> or <code>chipid=polynomial</code> per line):</label>
+          <textarea id="sensorPolynomials" name="sensorPolynomials" rows="4">%SENSOR_POLYNOMIALS%</textarea>
+        </div>
+        <div class="form-group">
+          <label for="sensorConfigs">Per-sensor settings, sent when the sensor next asks (one <code>name interval=900 samples=10 tilt_deadband=0.1 temp_deadband=0.2</code> or <code>chipid ...</code> per line):</label>
+          <textarea id="sensorConfigs" name="sensorConfigs" rows="4">%SENSOR_CONFIGS%</textarea>
+        </div>
       </fieldset>
     </div>
 
@@ -72,33 +88,128 @@ static const char CONFIG_HTML[] PROGMEM = R"rawliteral(
 </html>
 )rawliteral";
 
-String ConfigPortal::processTemplate(const String& deviceName,
-                                    const String& wifiSSID,
-                                    const String& wifiPassword,
-                                    const String& polynomial,
-                                    const String& brewfatherURL) const
+// Placeholders in CONFIG_HTML and what replaces them.
+struct PageField
 {
-    String html = CONFIG_HTML;
-    html.replace("%DEVICE_NAME%", deviceName);
-    html.replace("%WIFI_SSID%", wifiSSID);
-    html.replace("%WIFI_PASSWORD%", wifiPassword);
-    html.replace("%POLYNOMIAL%", polynomial);
-    html.replace("%BREWFATHER_URL%", brewfatherURL);
-    return html;
+    const char* placeholder;
+    const char* value;
+    bool escape; // user text, as opposed to markup
+};
+
+void ConfigPortal::sendChunk(const char* data, size_t len)
+{
+    // An empty chunk would end the chunked response.
+    if (len != 0)
+        server_.sendContent(data, len);
+}
+
+void ConfigPortal::sendEscaped(const char* text)
+{
+    char buf[64];
+    size_t n = 0;
+    for (; *text; text++)
+    {
+        const char* entity = nullptr;
+        switch (*text)
+        {
+        case '&': entity = "&amp;"; break;
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        case '"': entity = "&quot;"; break;
+        case '\'': entity = "&#39;"; break;
+        default: break;
+        }
+        const size_t need = entity ? strlen(entity) : 1;
+        if (n + need > sizeof(buf))
+        {
+            sendChunk(buf, n);
+            n = 0;
+        }
+        if (entity)
+            memcpy(buf + n, entity, need);
+        else
+            buf[n] = *text;
+        n += need;
+    }
+    sendChunk(buf, n);
+}
+
+void ConfigPortal::sendPage(const String& deviceName,
+                            const String& wifiSSID,
+                            const String& wifiPassword,
+                            const String& polynomial,
+                            const String& sensorPolynomials,
+                            const String& sensorConfigs,
+                            const String& brewfatherURL,
+                            bool wifiCoexist)
+{
+    const PageField fields[] = {
+        {"%DEVICE_NAME%", deviceName.c_str(), true},
+        {"%WIFI_SSID%", wifiSSID.c_str(), true},
+        {"%WIFI_PASSWORD%", wifiPassword.c_str(), true},
+        {"%POLYNOMIAL%", polynomial.c_str(), true},
+        {"%SENSOR_POLYNOMIALS%", sensorPolynomials.c_str(), true},
+        {"%SENSOR_CONFIGS%", sensorConfigs.c_str(), true},
+        {"%BREWFATHER_URL%", brewfatherURL.c_str(), true},
+        {"%WIFI_COEXIST%", wifiCoexist ? "checked" : "", false},
+    };
+
+    // Chunked: the page goes out as it is read from flash, with no copy of
+    // it in RAM. (Flash is memory mapped on the ESP32, so the string
+    // functions can scan it directly.) A '%' that starts no placeholder,
+    // as in the CSS, is plain text.
+    server_.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server_.send(200, "text/html", "");
+
+    const char* run = CONFIG_HTML;
+    const char* p = CONFIG_HTML;
+    while ((p = strchr(p, '%')) != nullptr)
+    {
+        const PageField* field = nullptr;
+        for (const PageField& f : fields)
+        {
+            if (strncmp(p, f.placeholder, strlen(f.placeholder)) == 0)
+            {
+                field = &f;
+                break;
+            }
+        }
+        if (!field)
+        {
+            p++;
+            continue;
+        }
+
+        sendChunk(run, (size_t)(p - run));
+        if (field->escape)
+            sendEscaped(field->value);
+        else
+            sendChunk(field->value, strlen(field->value));
+        p += strlen(field->placeholder);
+        run = p;
+    }
+    sendChunk(run, strlen(run));
+    server_.sendContent("", 0); // last chunk
 }
 
 void ConfigPortal::saveSettings(const String& deviceName,
                                const String& wifiSSID,
                                const String& wifiPassword,
                                const String& polynomial,
-                               const String& brewfatherURL)
+                               const String& sensorPolynomials,
+                               const String& sensorConfigs,
+                               const String& brewfatherURL,
+                               bool wifiCoexist)
 {
     preferences_.begin("tilted", false);
     preferences_.putString("deviceName", deviceName);
     preferences_.putString("wifiSSID", wifiSSID);
     preferences_.putString("wifiPassword", wifiPassword);
     preferences_.putString("polynomial", polynomial);
+    preferences_.putString("sensorPolys", sensorPolynomials);
+    preferences_.putString("sensorConfigs", sensorConfigs);
     preferences_.putString("brewfatherURL", brewfatherURL);
+    preferences_.putBool("wifiCoexist", wifiCoexist);
     preferences_.end();
 
     Serial.println("Settings saved");
@@ -108,18 +219,18 @@ void ConfigPortal::start(String& deviceName,
                          String& wifiSSID,
                          String& wifiPassword,
                          String& polynomial,
-                         String& brewfatherURL)
+                         String& sensorPolynomials,
+                         String& sensorConfigs,
+                         String& brewfatherURL,
+                         bool& wifiCoexist)
 {
-    WiFi.disconnect();
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP(apSSID_, apPassword_);
-
-    Serial.println("AP Started");
     Serial.print("IP Address: ");
     Serial.println(WiFi.softAPIP());
 
+    saved_ = false;
+
   server_.on("/", HTTP_GET, [&]() {
-    server_.send(200, "text/html", processTemplate(deviceName, wifiSSID, wifiPassword, polynomial, brewfatherURL));
+    sendPage(deviceName, wifiSSID, wifiPassword, polynomial, sensorPolynomials, sensorConfigs, brewfatherURL, wifiCoexist);
   });
 
     server_.on("/status", HTTP_GET, [&]() {
@@ -154,18 +265,21 @@ void ConfigPortal::start(String& deviceName,
         wifiSSID = server_.arg("wifiSSID");
         wifiPassword = server_.arg("wifiPassword");
         polynomial = server_.arg("polynomial");
+        sensorPolynomials = server_.arg("sensorPolynomials");
+        sensorConfigs = server_.arg("sensorConfigs");
         brewfatherURL = server_.arg("brewfatherURL");
+        wifiCoexist = server_.hasArg("wifiCoexist");
 
-        saveSettings(deviceName, wifiSSID, wifiPassword, polynomial, brewfatherURL);
+        saveSettings(deviceName, wifiSSID, wifiPassword, polynomial, sensorPolynomials, sensorConfigs, brewfatherURL,
+                     wifiCoexist);
 
+        // The owner applies the settings from loop() (see takeSaved()).
         server_.send(200,
                      "text/html",
-                     "<html><head><meta http-equiv='refresh' content='5;url=/'></head>"
+                     "<html><head><meta http-equiv='refresh' content='3;url=/'></head>"
                      "<body><h1>Configuration Saved</h1>"
-                     "<p>The device will restart in 5 seconds.</p></body></html>");
-
-        delay(5000);
-        ESP.restart();
+                     "<p>The settings are in use now.</p></body></html>");
+        saved_ = true;
     });
 
     server_.begin();
@@ -176,6 +290,19 @@ void ConfigPortal::start(String& deviceName,
     Serial.println("Configuration mode started");
 }
 
+void ConfigPortal::stop()
+{
+    dnsServer_.stop();
+    server_.stop();
+}
+
+bool ConfigPortal::takeSaved()
+{
+    const bool saved = saved_;
+    saved_ = false;
+    return saved;
+}
+
 void ConfigPortal::handle()
 {
     dnsServer_.processNextRequest();
@@ -6,11 +6,18 @@
 
 // Small captive portal + config page for the gateway.
 //
+// The portal only serves pages; the owner brings the access point up (see
+// EspNowReceiver::beginWithAccessPoint()), so ESP-NOW keeps receiving while
+// the gateway is configured. Saving stores the settings in Preferences and
+// updates the strings passed to start(); the owner applies them when
+// takeSaved() says so, without a restart.
+//
 // Usage:
 //   ConfigPortal portal(preferences);
 //   portal.setApCredentials("TiltedGateway-Setup", "tilted123");
-//   portal.start(deviceName, wifiSSID, wifiPassword, polynomial, brewfatherURL);
-//   ... loop: portal.handle();
+//   portal.start(deviceName, wifiSSID, wifiPassword, polynomial, sensorPolynomials, sensorConfigs, brewfatherURL,
+//                wifiCoexist);
+//   ... loop: portal.handle(); if (portal.takeSaved()) { apply; }
 //
 class ConfigPortal
 {
@@ -25,28 +32,47 @@ public:
         apPassword_ = password;
     }
 
-    // Starts AP mode and the captive portal web server.
+    // Starts the captive portal web server on the running access point.
+    // The strings must outlive the portal.
     void start(String& deviceName,
                String& wifiSSID,
                String& wifiPassword,
                String& polynomial,
-               String& brewfatherURL);
+               String& sensorPolynomials,
+               String& sensorConfigs,
+               String& brewfatherURL,
+               bool& wifiCoexist);
 
     // Must be called frequently from loop() while in config mode.
     void handle();
 
+    // Stops serving; the access point is the owner's to take down.
+    void stop();
+
+    // True once after each save.
+    bool takeSaved();
+
 private:
-    String processTemplate(const String& deviceName,
-                           const String& wifiSSID,
-                           const String& wifiPassword,
-                           const String& polynomial,
-                           const String& brewfatherURL) const;
+    // Streams the config page from flash, filling in the current values.
+    void sendPage(const String& deviceName,
+                  const String& wifiSSID,
+                  const String& wifiPassword,
+                  const String& polynomial,
+                  const String& sensorPolynomials,
+                  const String& sensorConfigs,
+                  const String& brewfatherURL,
+                  bool wifiCoexist);
+    void sendChunk(const char* data, size_t len);
+    void sendEscaped(const char* text);
 
     void saveSettings(const String& deviceName,
                       const String& wifiSSID,
                       const String& wifiPassword,
                       const String& polynomial,
-                      const String& brewfatherURL);
+                      const String& sensorPolynomials,
+                      const String& sensorConfigs,
+                      const String& brewfatherURL,
+                      bool wifiCoexist);
 
 private:
     Preferences& preferences_;
@@ -55,4 +81,5 @@ private:
 
     const char* apSSID_ = "";
     const char* apPassword_ = "";
+    bool saved_ = false;
 };
@@ -3,12 +3,13 @@
 #include "WiFi.h"
 #include <esp_now.h>
 #include <esp_wifi.h>
+#include <time.h>
 
-#include <ArduinoJson.h>
-
-#include <tinyexpr.h>
-
-#include "tilted_protocol.h"
+#include "tilted_json_writer.h"
+#include "tilted_log.h"
+#include "tilted_packet_builder.h"
+#include "tilted_value_helper.h"
+#include "wall_clock.h"
 
 EspNowReceiver* EspNowReceiver::self_ = nullptr;
 
@@ -24,18 +25,348 @@ EspNowReceiver::EspNowReceiver()
     };
     memcpy(staMac_, defaultMac, 6);
     channel_ = TILTED_ESPNOW_CHANNEL;
+    stateMutex_ = xSemaphoreCreateMutex();
 }
 
-void EspNowReceiver::setPolynomial(const String& polynomial)
+bool EspNowReceiver::setPolynomial(const String& polynomial)
 {
-    polynomial_ = polynomial;
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    const bool ok = polynomial_.compile(polynomial);
+    xSemaphoreGive(stateMutex_);
+    return ok;
 }
 
-bool EspNowReceiver::begin()
+bool EspNowReceiver::setSensorPolynomial(uint32_t chipId, const String& polynomial)
 {
-    // ensure singleton callback target
-    self_ = this;
+    return storeSensorPolynomial(chipId, "", polynomial);
+}
+
+bool EspNowReceiver::setSensorPolynomial(const char* name, const String& polynomial)
+{
+    if (!name || name[0] == '\0' || strlen(name) > TILTED_MAX_NAME_LEN)
+        return false;
+    return storeSensorPolynomial(0, name, polynomial);
+}
+
+bool EspNowReceiver::storeSensorPolynomial(uint32_t chipId, const char* name, const String& polynomial)
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+
+    SensorPolynomial* entry = nullptr;
+    SensorPolynomial* freeEntry = nullptr;
+    for (auto& sp : sensorPolynomials_)
+    {
+        if (!sp.used)
+        {
+            if (!freeEntry)
+                freeEntry = &sp;
+        }
+        else if (sp.chipId == chipId && strcmp(sp.name, name) == 0)
+        {
+            entry = &sp;
+            break;
+        }
+    }
+
+    if (entry)
+        entry->stale = false;
+
+    bool ok = true;
+    if (polynomial.isEmpty())
+    {
+        if (entry)
+        {
+            entry->poly.clear();
+            entry->used = false;
+        }
+    }
+    else
+    {
+        if (!entry)
+            entry = freeEntry;
+
+        if (!entry)
+        {
+            TILTED_LOGE("Sensor polynomial table full\n");
+            ok = false;
+        }
+        else if (!GravityPolynomial::parses(polynomial))
+        {
+            // compile() clears first: a typo must not cost the sensor the
+            // override it has.
+            ok = false;
+        }
+        else
+        {
+            entry->chipId = chipId;
+            entry->stale = false;
+            strncpy(entry->name, name, TILTED_MAX_NAME_LEN);
+            entry->name[TILTED_MAX_NAME_LEN] = '\0';
+            ok = entry->poly.compile(polynomial);
+            entry->used = ok;
+        }
+    }
+
+    if (++polyGeneration_ == 0)
+        polyGeneration_ = 1;
+    xSemaphoreGive(stateMutex_);
+    return ok;
+}
+
+void EspNowReceiver::beginSensorPolynomialUpdate()
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    for (auto& sp : sensorPolynomials_)
+        sp.stale = sp.used;
+    xSemaphoreGive(stateMutex_);
+}
+
+void EspNowReceiver::endSensorPolynomialUpdate()
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    for (auto& sp : sensorPolynomials_)
+    {
+        if (!sp.stale)
+            continue;
+        sp.poly.clear();
+        sp.used = false;
+        sp.stale = false;
+    }
+    if (++polyGeneration_ == 0)
+        polyGeneration_ = 1;
+    xSemaphoreGive(stateMutex_);
+}
+
+EspNowReceiver::SensorPolynomial* EspNowReceiver::findSensorPolynomial(uint32_t chipId, const char* name)
+{
+    // chipId matches win over name matches.
+    SensorPolynomial* byName = nullptr;
+    for (auto& sp : sensorPolynomials_)
+    {
+        if (!sp.used)
+            continue;
+        if (sp.name[0] == '\0')
+        {
+            if (sp.chipId == chipId)
+                return &sp;
+        }
+        else if (!byName && strcmp(sp.name, name) == 0)
+        {
+            byName = &sp;
+        }
+    }
+    return byName;
+}
+
+static bool settingKeyIs(const char* key, size_t keyLen, const char* name)
+{
+    return strlen(name) == keyLen && strncmp(key, name, keyLen) == 0;
+}
+
+// Parses a settings spec (see setSensorConfig()) into config items.
+static bool parseSensorConfig(const char* spec, TiltedValueItem* items, uint8_t& count)
+{
+    count = 0;
+    const char* p = spec;
+    for (;;)
+    {
+        while (*p == ' ' || *p == ',' || *p == '\t')
+            p++;
+        if (*p == '\0')
+            return true;
+
+        const char* key = p;
+        while (*p != '\0' && *p != '=' && *p != ' ' && *p != ',')
+            p++;
+        const size_t keyLen = (size_t)(p - key);
+        if (*p != '=')
+        {
+            TILTED_LOGE("Sensor setting without value: %.*s\n", (int)keyLen, key);
+            return false;
+        }
+
+        char* end = nullptr;
+        const float value = strtof(p + 1, &end);
+        if (end == p + 1 || !(value >= 0.0f) || count >= TILTED_MAX_CONFIG_ITEMS)
+        {
+            TILTED_LOGE("Bad sensor setting: %.*s\n", (int)keyLen, key);
+            return false;
+        }
+        p = end;
+
+        if (settingKeyIs(key, keyLen, "interval"))
+            items[count++] = TiltedValueHelper::intervalS(lroundf(value));
+        else if (settingKeyIs(key, keyLen, "samples"))
+            items[count++] = TiltedValueHelper::sampleCount(lroundf(value));
+        else if (settingKeyIs(key, keyLen, "tilt_deadband"))
+            items[count++] = TiltedValueHelper::tiltDeadband(value);
+        else if (settingKeyIs(key, keyLen, "temp_deadband"))
+            items[count++] = TiltedValueHelper::tempDeadband(value);
+        else
+        {
+            TILTED_LOGE("Unknown sensor setting: %.*s\n", (int)keyLen, key);
+            return false;
+        }
+    }
+}
+
+// Derived from the settings themselves, so a gateway restart does not resend
+// settings its sensors already have. Never 0 (= no settings).
+static uint16_t sensorConfigVersion(const TiltedValueItem* items, uint8_t count)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(items);
+    for (size_t i = 0; i < (size_t)count * sizeof(TiltedValueItem); i++)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    const uint16_t version = (uint16_t)(h ^ (h >> 16));
+    return version ? version : 1;
+}
+
+bool EspNowReceiver::setSensorConfig(uint32_t chipId, const String& spec)
+{
+    return storeSensorConfig(chipId, "", spec);
+}
 
+bool EspNowReceiver::setSensorConfig(const char* name, const String& spec)
+{
+    if (!name || name[0] == '\0' || strlen(name) > TILTED_MAX_NAME_LEN)
+        return false;
+    return storeSensorConfig(0, name, spec);
+}
+
+bool EspNowReceiver::storeSensorConfig(uint32_t chipId, const char* name, const String& spec)
+{
+    TiltedValueItem items[TILTED_MAX_CONFIG_ITEMS];
+    uint8_t count = 0;
+    if (!parseSensorConfig(spec.c_str(), items, count))
+        return false;
+
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+
+    SensorConfig* entry = nullptr;
+    SensorConfig* freeEntry = nullptr;
+    for (auto& sc : sensorConfigs_)
+    {
+        if (!sc.used)
+        {
+            if (!freeEntry)
+                freeEntry = &sc;
+        }
+        else if (sc.chipId == chipId && strcmp(sc.name, name) == 0)
+        {
+            entry = &sc;
+            break;
+        }
+    }
+
+    bool ok = true;
+    if (count == 0)
+    {
+        if (entry)
+            entry->used = false;
+    }
+    else
+    {
+        if (!entry)
+            entry = freeEntry;
+
+        if (!entry)
+        {
+            TILTED_LOGE("Sensor settings table full\n");
+            ok = false;
+        }
+        else
+        {
+            entry->chipId = chipId;
+            strncpy(entry->name, name, TILTED_MAX_NAME_LEN);
+            entry->name[TILTED_MAX_NAME_LEN] = '\0';
+            memcpy(entry->items, items, (size_t)count * sizeof(TiltedValueItem));
+            entry->itemCount = count;
+            entry->version = sensorConfigVersion(items, count);
+            entry->used = true;
+        }
+    }
+
+    xSemaphoreGive(stateMutex_);
+    return ok;
+}
+
+void EspNowReceiver::clearSensorConfigs()
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    for (auto& sc : sensorConfigs_)
+        sc.used = false;
+    xSemaphoreGive(stateMutex_);
+}
+
+EspNowReceiver::SensorConfig* EspNowReceiver::findSensorConfig(uint32_t chipId, const char* name)
+{
+    // chipId matches win over name matches.
+    SensorConfig* byName = nullptr;
+    for (auto& sc : sensorConfigs_)
+    {
+        if (!sc.used)
+            continue;
+        if (sc.name[0] == '\0')
+        {
+            if (sc.chipId == chipId)
+                return &sc;
+        }
+        else if (!byName && strcmp(sc.name, name) == 0)
+        {
+            byName = &sc;
+        }
+    }
+    return byName;
+}
+
+uint16_t EspNowReceiver::encodeConfigReply(uint32_t chipId, const char* name, uint16_t sensorVersion, uint8_t* out,
+                                           uint16_t outMax)
+{
+    // A sensor that is up to date gets no reply; its short listen window
+    // just runs out. A removed entry is version 0 with no items, which
+    // returns the sensor to its defaults.
+    const SensorConfig* sc = findSensorConfig(chipId, name);
+    const uint16_t version = sc ? sc->version : 0;
+    if (version == sensorVersion)
+        return 0;
+    return tilted_encode_config_packet(out, outMax, chipId, version, sc ? sc->items : nullptr,
+                                       sc ? sc->itemCount : 0);
+}
+
+void EspNowReceiver::sendToSensor(const uint8_t* mac, const uint8_t* frame, uint16_t len)
+{
+    static const uint8_t unknown[6] = {};
+    if (memcmp(mac, unknown, 6) == 0)
+        return;
+
+    // Each sensor is added once and kept: only sensors whose settings
+    // changed are ever sent anything, far fewer than ESP-NOW's peer limit.
+    if (!esp_now_is_peer_exist(mac))
+    {
+        esp_now_peer_info_t peer{};
+        memcpy(peer.peer_addr, mac, 6);
+        peer.channel = 0; // the one we are on
+        peer.ifidx = WIFI_IF_STA;
+        peer.encrypt = false;
+        if (esp_now_add_peer(&peer) != ESP_OK)
+        {
+            TILTED_LOGE("Could not add sensor peer for reply\n");
+            return;
+        }
+    }
+
+    if (esp_now_send(mac, frame, len) == ESP_OK)
+        configReplies_++;
+    else
+        TILTED_LOGE("Config reply send failed\n");
+}
+
+bool EspNowReceiver::begin()
+{
     WiFi.softAPdisconnect(true);
     WiFi.disconnect();
     WiFi.mode(WIFI_STA);
@@ -45,49 +376,187 @@ bool EspNowReceiver::begin()
     esp_wifi_set_channel(channel_, WIFI_SECOND_CHAN_NONE);
     esp_wifi_set_promiscuous(false);
 
-    Serial.println();
-    Serial.println("ESP-Now Receiver");
-    Serial.printf("Transmitter mac: %s\n", WiFi.macAddress().c_str());
-    Serial.printf("Receiver mac: %s\n", WiFi.softAPmacAddress().c_str());
+    return initEspNow();
+}
+
+bool EspNowReceiver::beginWithStation(const char* ssid, const char* password, uint32_t connectTimeoutMs)
+{
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    // Stay responsive to ESP-NOW: modem sleep would make us miss frames between beacons.
+    WiFi.setSleep(false);
+
+    // Sensors address the gateway by this MAC, so set it before associating.
+    esp_wifi_set_mac(WIFI_IF_STA, &staMac_[0]);
+    WiFi.begin(ssid, password);
+
+    const uint32_t start = millis();
+    while (WiFi.status() != WL_CONNECTED && (millis() - start) < connectTimeoutMs)
+    {
+        delay(250);
+        TILTED_LOGI(".");
+        tilted_log_flush();
+    }
+
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        TILTED_LOGI("\nWiFi connected, IP address: %s\n", WiFi.localIP().toString().c_str());
+    }
+    else
+    {
+        // Keep going: auto-reconnect will pick the AP up later and ESP-NOW
+        // follows the station onto the AP's channel.
+        TILTED_LOGE("\nWiFi connection failed, receiving on current channel\n");
+    }
+
+    return initEspNow();
+}
+
+bool EspNowReceiver::beginWithAccessPoint(const char* ssid, const char* password)
+{
+    WiFi.disconnect();
+    WiFi.mode(WIFI_AP_STA);
+
+    // Sensors address the station interface; the AP keeps its own MAC. The
+    // AP fixes the channel for both.
+    esp_wifi_set_mac(WIFI_IF_STA, &staMac_[0]);
+    if (!WiFi.softAP(ssid, password, channel_))
+        TILTED_LOGE("Setup AP failed to start\n");
+
+    return initEspNow();
+}
+
+bool EspNowReceiver::initEspNow()
+{
+    // ensure singleton callback target
+    self_ = this;
+
+    // The worker survives re-initialisation of the radio; only start it once.
+    if (worker_ == nullptr)
+    {
+        if (xTaskCreatePinnedToCore(&EspNowReceiver::workerTask,
+                                    "espnow_rx",
+                                    WORKER_STACK_BYTES,
+                                    this,
+                                    WORKER_PRIORITY,
+                                    &worker_,
+                                    WORKER_CORE) != pdPASS)
+        {
+            worker_ = nullptr;
+            TILTED_LOGE("ESP-Now worker task creation failed...\n");
+            return false;
+        }
+    }
+
+    TILTED_LOGI("\nESP-Now Receiver\n");
+    TILTED_LOGI("Transmitter mac: %s\n", WiFi.macAddress().c_str());
+    TILTED_LOGI("Receiver mac: %s\n", WiFi.softAPmacAddress().c_str());
 
     if (esp_now_init() != ESP_OK)
     {
-        Serial.println("ESP_Now init failed...");
+        TILTED_LOGE("ESP_Now init failed...\n");
         return false;
     }
 
-    Serial.println(WiFi.channel());
+    TILTED_LOGI("%d\n", WiFi.channel());
     esp_now_register_recv_cb(&EspNowReceiver::recvCb);
-    Serial.println("Slave ready. Waiting for messages...");
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    // The IDF 4 callback has no rx_ctrl; read RSSI and channel from the
+    // frames themselves. Management frames only: ESP-NOW is one of them.
+    const wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_MGMT};
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(&EspNowReceiver::promiscuousCb);
+    esp_wifi_set_promiscuous(true);
+#endif
+    TILTED_LOGI("Slave ready. Waiting for messages...\n");
     return true;
 }
 
+uint8_t EspNowReceiver::channel() const
+{
+    uint8_t primary = channel_;
+    wifi_second_chan_t second = WIFI_SECOND_CHAN_NONE;
+    if (esp_wifi_get_channel(&primary, &second) != ESP_OK)
+        return channel_;
+    return primary;
+}
+
 bool EspNowReceiver::hasPending() const
 {
-    return havePending_;
+    return !txQueue_.empty();
 }
 
 void EspNowReceiver::clearPending()
 {
-    havePending_ = false;
+    txQueue_.clear();
+}
+
+// Outbound slot layout: chipId (4), timestamp (4), frame length (1), raw frame, JSON text.
+static constexpr uint16_t TX_SLOT_TIMESTAMP = sizeof(uint32_t);
+static constexpr uint16_t TX_SLOT_FRAME_LEN = TX_SLOT_TIMESTAMP + sizeof(uint32_t);
+static constexpr uint16_t TX_SLOT_HEADER = TX_SLOT_FRAME_LEN + 1;
+
+bool EspNowReceiver::peekPending(PendingReading& out) const
+{
+    uint16_t slotLen = 0;
+    const uint8_t* slot = txQueue_.front(slotLen);
+    if (!slot || slotLen <= TX_SLOT_HEADER || slotLen <= TX_SLOT_HEADER + slot[TX_SLOT_FRAME_LEN])
+        return false;
+
+    memcpy(&out.chipId, slot, sizeof(uint32_t));
+    memcpy(&out.timestamp, slot + TX_SLOT_TIMESTAMP, sizeof(uint32_t));
+    out.frameLen = slot[TX_SLOT_FRAME_LEN];
+    out.frame = slot + TX_SLOT_HEADER;
+    out.json = reinterpret_cast<const char*>(out.frame + out.frameLen);
+    out.jsonLen = slotLen - TX_SLOT_HEADER - out.frameLen;
+    return true;
+}
+
+void EspNowReceiver::popPending()
+{
+    txQueue_.pop();
 }
 
-String EspNowReceiver::takePendingJson()
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+void EspNowReceiver::recvCb(const esp_now_recv_info_t* info, const uint8_t* incomingData, int len)
 {
-    if (!havePending_)
-        return String();
+    if (self_ && info)
+    {
+        const int8_t rssi = info->rx_ctrl ? (int8_t)info->rx_ctrl->rssi : 0;
+        const uint8_t channel = info->rx_ctrl ? (uint8_t)info->rx_ctrl->channel : 0;
+        self_->onRecv(info->src_addr, rssi, channel, incomingData, len);
+    }
+}
+#else
+EspNowReceiver::LastRx EspNowReceiver::lastRx_{};
 
-    havePending_ = false;
-    String out = pendingJson_;
-    pendingJson_ = String();
-    return out;
+void EspNowReceiver::promiscuousCb(void* buf, wifi_promiscuous_pkt_type_t type)
+{
+    // Same WiFi task as recvCb, and called for each frame before ESP-NOW
+    // gets it, so no locking is needed.
+    if (type != WIFI_PKT_MGMT || !buf)
+        return;
+    const auto* pkt = static_cast<const wifi_promiscuous_pkt_t*>(buf);
+    const uint8_t* p = pkt->payload;
+    // ESP-NOW rides in action frames: 24-byte MAC header, then category 127
+    // (vendor specific) and Espressif's OUI. The sender is address 2.
+    if (pkt->rx_ctrl.sig_len < 28 || p[0] != 0xD0 || p[24] != 127 || p[25] != 0x18 || p[26] != 0xFE ||
+        p[27] != 0x34)
+        return;
+    memcpy(lastRx_.mac, p + 10, 6);
+    lastRx_.rssiDbm = (int8_t)pkt->rx_ctrl.rssi;
+    lastRx_.channel = (uint8_t)pkt->rx_ctrl.channel;
 }
 
 void EspNowReceiver::recvCb(const uint8_t* senderMac, const uint8_t* incomingData, int len)
 {
-    if (self_)
-        self_->onRecv(senderMac, incomingData, len);
+    if (!self_)
+        return;
+    const bool known = senderMac && memcmp(lastRx_.mac, senderMac, 6) == 0;
+    self_->onRecv(senderMac, known ? lastRx_.rssiDbm : 0, known ? lastRx_.channel : 0, incomingData, len);
 }
+#endif
 
 static inline float round3(float value)
 {
@@ -99,95 +568,443 @@ static inline float round5(float value)
     return roundf(value * 100000.0f) / 100000.0f;
 }
 
-static float calculateGravityFromPolynomial(const String& polynomial, double tilt, double temp)
+GravityPolynomial* EspNowReceiver::sensorPolynomialFor(uint32_t chipId, const char* name, SensorTable::Entry* entry)
 {
-    if (polynomial.isEmpty())
+    if (entry && entry->polyGeneration == polyGeneration_)
+        return entry->poly;
+
+    SensorPolynomial* sp = findSensorPolynomial(chipId, name);
+    GravityPolynomial* poly = sp ? &sp->poly : nullptr;
+    if (entry)
+    {
+        entry->poly = poly;
+        entry->polyGeneration = polyGeneration_;
+    }
+    return poly;
+}
+
+float EspNowReceiver::evaluateGravity(uint32_t chipId, const char* name, SensorTable::Entry* entry, float tilt,
+                                      float temp)
+{
+    GravityPolynomial* own = sensorPolynomialFor(chipId, name, entry);
+    GravityPolynomial& poly = own ? *own : polynomial_;
+    if (!poly.valid())
         return NAN;
 
-    Serial.printf("Calculating gravity from polynomial: '%s'\n", polynomial.c_str());
-    Serial.printf("tilt=%.3f temp=%.3f\n", tilt, temp);
+    TILTED_LOGD("Calculating gravity from %s polynomial: '%s'\n", own ? "sensor" : "default", poly.expression().c_str());
+    TILTED_LOGD("tilt=%.3f temp=%.3f\n", tilt, temp);
+
+    float gravity = round5(poly.evaluate(tilt, temp));
+    TILTED_LOGD("Calculated gravity: %.5f\n", gravity);
+    return gravity;
+}
+
+// Magic and minimum length only; the worker validates the rest.
+static bool plausibleFrame(const uint8_t* data, uint16_t len)
+{
+    uint16_t magic;
+    if (len < sizeof(magic))
+        return false;
+    memcpy(&magic, data, sizeof(magic));
+    if (magic == TILTED_MAGIC || magic == TILTED_BATCH_MAGIC)
+        return len >= sizeof(TiltedReadingsHeader);
+    if (magic == TILTED_COMPACT_MAGIC)
+        return len >= sizeof(magic) + sizeof(uint32_t);
+    return false;
+}
+
+void EspNowReceiver::onRecv(const uint8_t* senderMac, int8_t rssiDbm, uint8_t channel, const uint8_t* incomingData,
+                            int len)
+{
+    // Runs in the WiFi task: validate magic/length, copy the raw frame and
+    // wake the worker. No decoding, allocation or logging here.
+    if (senderMac)
+        memcpy(lastSender_, senderMac, 6);
+
+    // ESP-NOW v1 never delivers more than RX_FRAME_MAX bytes.
+    if (!(incomingData && len > 0 && len <= RX_FRAME_MAX))
+        return;
+    if (!plausibleFrame(incomingData, (uint16_t)len))
+        return;
+
+    // A full queue is counted in queueDrops().
+    uint8_t* slot = rxQueue_.reserve();
+    if (!slot)
+        return;
+    slot[0] = (uint8_t)rssiDbm;
+    slot[1] = channel;
+    if (senderMac)
+        memcpy(slot + 2, senderMac, 6);
+    else
+        memset(slot + 2, 0, 6);
+    memcpy(slot + RX_SLOT_HEADER, incomingData, (size_t)len);
+    rxQueue_.commit((uint16_t)(RX_SLOT_HEADER + len));
+    if (worker_ != nullptr)
+        xTaskNotifyGive(worker_);
+}
 
-    int err = 0;
-    te_variable vars[] = {{"tilt", &tilt}, {"temp", &temp}};
-    te_expr* expr = te_compile(polynomial.c_str(), vars, 2, &err);
-    if (!expr)
+void EspNowReceiver::workerTask(void* arg)
+{
+    auto* self = static_cast<EspNowReceiver*>(arg);
+    for (;;)
     {
-        Serial.printf("Could not calculate gravity. Parse error at %d\n", err);
-        return NAN;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->processFrames();
     }
+}
 
-    float gravity = (float)te_eval(expr);
-    te_free(expr);
-    gravity = round5(gravity);
-    Serial.printf("Calculated gravity: %.5f\n", gravity);
-    return gravity;
+void EspNowReceiver::processFrames()
+{
+    uint16_t slotLen = 0;
+    while (const uint8_t* slot = rxQueue_.front(slotLen))
+    {
+        RxInfo rx{(int8_t)slot[0], slot[1], {}};
+        memcpy(rx.mac, slot + 2, sizeof(rx.mac));
+        if (rx.channel == 0)
+            rx.channel = channel();
+        const uint8_t* frame = slot + RX_SLOT_HEADER;
+        const uint16_t len = slotLen - RX_SLOT_HEADER;
+
+        TiltedReadingsView view{};
+        TiltedBatchView batch{};
+        TiltedCompactView compact{};
+        if (tilted_decode_readings_view(frame, len, view))
+            stageReading(frame, len, 0, rx);
+        else if (tilted_decode_batch_view(frame, len, batch))
+            unpackBatch(batch, rx);
+        else if (tilted_decode_compact_view(frame, len, compact))
+            unpackCompact(compact, rx);
+        else
+            TILTED_LOGD("Dropping malformed frame len=%u\n", (unsigned)len);
+        rxQueue_.pop();
+    }
 }
 
-void EspNowReceiver::onRecv(const uint8_t* senderMac, const uint8_t* incomingData, int len)
+void EspNowReceiver::stageReading(const uint8_t* frame, uint16_t len, uint32_t timestamp, const RxInfo& rx)
 {
-    memcpy(lastSender_, senderMac, 6);
+    // Write straight into the outbound slot. The raw frame rides along
+    // so undeliverable readings can be spooled compactly.
+    // A full queue is counted in payloadDrops().
+    if (len > 0xFF) // the slot stores the length in one byte
+        return;
+    bool haveSeq = false;
+    uint32_t seq = 0;
+    uint8_t* slot = admitReading(frame, len, rx, haveSeq, seq);
+    if (!slot)
+        return;
 
-    TiltedReadingsView view{};
-    if (!(incomingData && len > 0 && tilted_decode_readings_view(incomingData, (uint16_t)len, view)))
+    // Live readings carry the RSSI they arrived with; a backdated one was
+    // taken long before this frame.
+    uint8_t withRssi[TILTED_MAX_FRAME_LEN];
+    if (rx.rssiDbm != 0 && timestamp == 0 && len <= sizeof(withRssi))
     {
-        Serial.printf("Ignoring non-TLV packet len=%d\n", len);
+        memcpy(withRssi, frame, len);
+        const uint16_t grown = tilted_append_readings_item(withRssi, len, sizeof(withRssi),
+                                                           TiltedValueHelper::rssiDbm(rx.rssiDbm));
+        if (grown != 0)
+        {
+            frame = withRssi;
+            len = grown;
+        }
+    }
+
+    const uint16_t jsonOffset = TX_SLOT_HEADER + len;
+    char* json = reinterpret_cast<char*>(slot + jsonOffset);
+    const uint16_t wrote = encodeReading(frame, len, timestamp, json, TX_PAYLOAD_MAX - jsonOffset, true);
+    if (wrote == 0)
         return;
+
+    uint32_t chipId;
+    memcpy(&chipId, frame + offsetof(TiltedReadingsHeader, chipId), sizeof(chipId));
+    memcpy(slot, &chipId, sizeof(uint32_t));
+    memcpy(slot + TX_SLOT_TIMESTAMP, &timestamp, sizeof(uint32_t));
+    slot[TX_SLOT_FRAME_LEN] = (uint8_t)len;
+    memcpy(slot + TX_SLOT_HEADER, frame, len);
+    txQueue_.commit((uint16_t)(jsonOffset + wrote));
+
+    // Only now is the reading safe: until here a resend must get through.
+    if (haveSeq)
+        acceptSequence(chipId, seq);
+}
+
+// Unix time a reading taken ageS seconds ago was taken, or 0 to stamp it on
+// arrival. The newest set of a batch (age 0) is a live reading like any other.
+static uint32_t backdatedTimestamp(time_t now, uint32_t ageS)
+{
+    const bool backdate = now >= EPOCH_VALID_AFTER && ageS > 0 && (time_t)ageS < now;
+    return backdate ? (uint32_t)(now - ageS) : 0;
+}
+
+// Splits a batch into ordinary single-reading frames, so everything
+// downstream (JSON, spool, uplink) handles one reading at a time.
+void EspNowReceiver::unpackBatch(const TiltedBatchView& batch, const RxInfo& rx)
+{
+    const time_t now = time(nullptr);
+    if (now < EPOCH_VALID_AFTER)
+        TILTED_LOGI("Batch received before the clock is set; readings get their arrival time\n");
+
+    uint8_t single[TILTED_MAX_FRAME_LEN];
+    uint16_t offset = 0;
+    TiltedBatchSetView set{};
+    while (tilted_batch_next_set(batch, offset, set))
+    {
+        const uint16_t len = tilted_encode_readings_packet(
+            single, sizeof(single),
+            batch.header.chipId, batch.header.interval_s,
+            batch.name, batch.header.nameLen,
+            set.items, set.itemCount);
+        if (len == 0)
+            continue;
+
+        stageReading(single, len, backdatedTimestamp(now, set.ageS), rx);
+    }
+}
+
+// Expands a compact frame into v1 frames, one per set, so the JSON encoder,
+// spool and uplink only ever see the fixed-size TLV format.
+void EspNowReceiver::unpackCompact(const TiltedCompactView& compact, const RxInfo& rx)
+{
+    char name[TILTED_MAX_NAME_LEN];
+    const uint8_t nameLen = resolveName(compact, name);
+
+    const time_t now = time(nullptr);
+    if (compact.batch && now < EPOCH_VALID_AFTER)
+        TILTED_LOGI("Batch received before the clock is set; readings get their arrival time\n");
+
+    uint8_t single[TILTED_MAX_FRAME_LEN];
+    TiltedValueItem items[TILTED_COMPACT_MAX_ITEMS];
+    TiltedCompactCursor cursor{};
+    uint32_t ageS = 0;
+    uint8_t itemCount = 0;
+    while (tilted_compact_next_set(compact, cursor, ageS, items, itemCount))
+    {
+        const uint16_t len = tilted_encode_readings_packet(
+            single, sizeof(single),
+            compact.chipId, compact.intervalS,
+            name, nameLen,
+            items, itemCount);
+        if (len == 0)
+            continue;
+
+        stageReading(single, len, backdatedTimestamp(now, ageS), rx);
+    }
+}
+
+uint8_t EspNowReceiver::resolveName(const TiltedCompactView& compact, char* out)
+{
+    // The name is stored with the rest of the sensor state once the
+    // expanded frame is admitted.
+    if (compact.name)
+    {
+        memcpy(out, compact.name, compact.nameLen);
+        return compact.nameLen;
+    }
+
+    uint8_t len = 0;
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    if (const SensorTable::Entry* e = sensors_.find(compact.chipId))
+    {
+        len = e->nameLen;
+        memcpy(out, e->name, len);
+    }
+    xSemaphoreGive(stateMutex_);
+    if (len != 0)
+        return len;
+
+    // Not seen since the gateway booted: use the name the sensor firmware
+    // derives from its chip id anyway.
+    char fallback[TILTED_MAX_NAME_LEN + 1];
+    int n = snprintf(fallback, sizeof(fallback), "tilt-%08x", (unsigned)compact.chipId);
+    if (n <= 0)
+        return 0;
+    if (n > TILTED_MAX_NAME_LEN)
+        n = TILTED_MAX_NAME_LEN;
+    memcpy(out, fallback, n);
+    return (uint8_t)n;
+}
+
+uint8_t* EspNowReceiver::admitReading(const uint8_t* frame, uint16_t len, const RxInfo& rx, bool& haveSeq,
+                                      uint32_t& seq)
+{
+    TiltedReadingsView view{};
+    if (!tilted_decode_readings_view(frame, len, view))
+        return nullptr;
+
+    haveSeq = false;
+    seq = 0;
+    uint32_t silenceLimitS = view.header.interval_s;
+    bool wantsConfig = false;
+    uint16_t configVersion = 0;
+    for (const TiltedValueItem it : tilted_items(view))
+    {
+        switch ((TiltedValueType)it.type)
+        {
+        case TiltedValueType::Sequence:
+            seq = (uint32_t)it.value;
+            haveSeq = true;
+            break;
+        case TiltedValueType::ConfigVersion:
+            configVersion = (uint16_t)it.value;
+            wantsConfig = true;
+            break;
+        case TiltedValueType::HeartbeatS:
+            if (it.value > 0)
+                silenceLimitS = (uint32_t)it.value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    const uint32_t chipId = view.header.chipId;
+    const uint8_t nameLen = (view.header.nameLen > TILTED_MAX_NAME_LEN) ? TILTED_MAX_NAME_LEN : view.header.nameLen;
+
+    const uint32_t now = millis();
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    // Sensors that skip unchanged readings are quiet on purpose; only a gap
+    // well past the silence they announced means we lost them.
+    uint32_t silentS = 0;
+    uint32_t expectedS = 0;
+    if (const SensorTable::Entry* prior = sensors_.find(chipId))
+    {
+        expectedS = prior->silenceLimitS;
+        silentS = (now - prior->lastSeenMs) / 1000;
+    }
+    SensorTable::Entry& e = sensors_.touch(chipId, now);
+    const bool outage = expectedS != 0 && silentS > expectedS + expectedS / 2;
+    if (outage)
+        e.outages++;
+    e.silenceLimitS = silenceLimitS;
+    if (nameLen != 0 && (nameLen != e.nameLen || memcmp(e.name, view.name, nameLen) != 0))
+    {
+        memcpy(e.name, view.name, nameLen);
+        e.nameLen = nameLen;
+        e.polyGeneration = 0; // name-keyed polynomials may differ
+    }
+    e.channel = rx.channel;
+    // A new reading counts as seen only once it is staged (see
+    // acceptSequence()): if the queue is full or encoding fails, a resend
+    // must not be mistaken for a duplicate.
+    const bool fresh = !haveSeq || !e.sequence.seen(seq);
+    uint8_t* slot = fresh ? txQueue_.reserve() : nullptr;
+    if (!fresh)
+        e.sequence.accept(seq); // counts the duplicate
+    // Duplicates still tell us about the link (another gateway's copy aside).
+    SensorTable::addRssi(e, rx.rssiDbm);
+    // The sensor listens only briefly: build the reply now, send it below.
+    // Copies of a reading already staged were answered the first time.
+    uint8_t reply[sizeof(TiltedConfigHeader) + TILTED_MAX_CONFIG_ITEMS * sizeof(TiltedValueItem)];
+    uint16_t replyLen = 0;
+    if (wantsConfig && slot)
+    {
+        char name[TILTED_MAX_NAME_LEN + 1];
+        memcpy(name, e.name, e.nameLen);
+        name[e.nameLen] = '\0';
+        replyLen = encodeConfigReply(chipId, name, configVersion, reply, sizeof(reply));
+    }
+    xSemaphoreGive(stateMutex_);
+
+    if (replyLen != 0)
+    {
+        sendToSensor(rx.mac, reply, replyLen);
+        TILTED_LOGD("Config reply to %08x: %u item(s)\n", (unsigned)chipId,
+                    (unsigned)reply[offsetof(TiltedConfigHeader, itemCount)]);
+    }
+
+    if (outage)
+        TILTED_LOGI("Sensor %08x silent for %lu s (expected within %lu s)\n", (unsigned)chipId,
+                    (unsigned long)silentS, (unsigned long)expectedS);
+
+    if (!fresh)
+    {
+        duplicateDrops_++;
+        TILTED_LOGI("Dropping duplicate reading %lu from %08x\n", (unsigned long)seq, (unsigned)chipId);
+    }
+    return slot;
+}
+
+void EspNowReceiver::acceptSequence(uint32_t chipId, uint32_t seq)
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    if (SensorTable::Entry* e = sensors_.find(chipId))
+        e->sequence.accept(seq);
+    xSemaphoreGive(stateMutex_);
+}
+
+bool EspNowReceiver::linkStats(uint8_t index, LinkStats& out) const
+{
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    const SensorTable::Entry* e = sensors_.at(index);
+    if (e)
+    {
+        out.chipId = e->chipId;
+        out.lastSeenMs = e->lastSeenMs;
+        out.rssiDbm = e->rssiDbm;
+        out.rssiAvgDbm = SensorTable::rssiAverage(*e);
+        out.channel = e->channel;
+        out.received = e->sequence.received();
+        out.lost = e->sequence.lost();
+        out.duplicates = e->sequence.duplicates();
+        out.lossPercent = e->sequence.lossPercent();
+        out.silenceLimitS = e->silenceLimitS;
+        out.outages = e->outages;
+    }
+    xSemaphoreGive(stateMutex_);
+    return e != nullptr;
+}
+
+uint16_t EspNowReceiver::encodeJson(const uint8_t* frame, uint16_t len, uint32_t timestamp, char* out, uint16_t outMax)
+{
+    return encodeReading(frame, len, timestamp, out, outMax, false);
+}
+
+uint16_t EspNowReceiver::encodeReading(const uint8_t* frame, uint16_t len, uint32_t timestamp, char* out,
+                                       uint16_t outMax, bool live)
+{
+    TiltedReadingsView view{};
+    if (!(frame && len > 0 && tilted_decode_readings_view(frame, len, view)))
+    {
+        TILTED_LOGD("Ignoring non-TLV packet len=%u\n", (unsigned)len);
+        return 0;
     }
 
     // Extract name to a printable buffer
     char name[TILTED_MAX_NAME_LEN + 1];
-    uint8_t nlen = view.header->nameLen;
+    uint8_t nlen = view.header.nameLen;
     if (nlen > TILTED_MAX_NAME_LEN)
         nlen = TILTED_MAX_NAME_LEN;
     memcpy(name, view.name, nlen);
     name[nlen] = '\0';
 
-    DynamicJsonDocument doc(512);
-    doc["name"] = name;
-
     bool haveTilt = false;
     bool haveTemp = false;
     float tilt = 0;
     float temp = 0;
+    int32_t batteryMv = 0;
 
-    for (uint8_t i = 0; i < view.header->itemCount; i++)
+    for (const TiltedValueItem it : tilted_items(view))
     {
-        const auto& it = view.items[i];
         switch ((TiltedValueType)it.type)
         {
         case TiltedValueType::Tilt:
-            tilt = (it.scale10 == -1) ? ((float)it.value / 10.0f) : (float)it.value;
-            doc["angle"] = tilt;
+            tilt = TiltedValueHelper::toFloat(it);
             haveTilt = true;
-            Serial.printf("Tilt: %.2f\n", tilt);
+            TILTED_LOGD("Tilt: %.2f\n", tilt);
             break;
         case TiltedValueType::Temp:
-            temp = (it.scale10 == -1) ? ((float)it.value / 10.0f) : (float)it.value;
-            doc["temp"] = temp;
-            doc["temp_unit"] = "C";
+            temp = TiltedValueHelper::toFloat(it);
             haveTemp = true;
-            Serial.printf("Temperature: %.2f\n", temp);
-            break;
-        case TiltedValueType::AuxTemp:
-        {
-            float auxTemp = (it.scale10 == -1) ? ((float)it.value / 10.0f) : (float)it.value;
-            doc["aux_temp"] = auxTemp;
-            doc["aux_temp_unit"] = "C";
+            TILTED_LOGD("Temperature: %.2f\n", temp);
             break;
-        }
         case TiltedValueType::BatteryMv:
-        {
-            int32_t mv = it.value;
-            doc["battery"] = (float)mv / 1000.0f;
-            Serial.printf("Voltage: %ld mV\n", (long)mv);
-            break;
-        }
-        case TiltedValueType::IntervalS:
-            doc["interval"] = it.value;
-            Serial.printf("Interval: %ld s\n", (long)it.value);
+            batteryMv = it.value;
+            TILTED_LOGD("Voltage: %ld mV\n", (long)it.value);
             break;
         case TiltedValueType::RssiDbm:
-            doc["rssi"] = it.value;
+            TILTED_LOGD("RSSI: %ld dBm\n", (long)it.value);
+            break;
+        case TiltedValueType::IntervalS:
+            TILTED_LOGD("Interval: %ld s\n", (long)it.value);
             break;
         default:
             break;
@@ -195,19 +1012,37 @@ void EspNowReceiver::onRecv(const uint8_t* senderMac, const uint8_t* incomingDat
     }
 
     // Gravity calculation: if we have tilt + temp and a polynomial configured, compute gravity.
-    if (haveTilt && haveTemp && !polynomial_.isEmpty())
+    float gravity = NAN;
+    xSemaphoreTake(stateMutex_, portMAX_DELAY);
+    SensorTable::Entry* entry = sensors_.find(view.header.chipId);
+    if (haveTilt && haveTemp)
+        gravity = evaluateGravity(view.header.chipId, name, entry, tilt, temp);
+    if (live && entry)
     {
-        float gravity = calculateGravityFromPolynomial(polynomial_, tilt, temp);
-        if (!isnan(gravity))
-        {
-            doc["gravity"] = gravity;
-            doc["gravity_unit"] = "G";
-        }
+        entry->tilt = haveTilt ? tilt : NAN;
+        entry->temp = haveTemp ? temp : NAN;
+        entry->gravity = gravity;
+        entry->batteryMv = batteryMv;
     }
+    xSemaphoreGive(stateMutex_);
 
-    pendingJson_ = String();
-    serializeJson(doc, pendingJson_);
-    havePending_ = true;
+    const bool haveGravity = isfinite(gravity);
+    TiltedJsonWriter w;
+    tilted_json_init(w, out, outMax);
+    tilted_json_begin_object(w);
+    tilted_json_readings_members(w, view, haveGravity, haveGravity ? (int32_t)lroundf(gravity * 100000.0f) : 0);
+    if (timestamp != 0)
+    {
+        tilted_json_key(w, "timestamp");
+        tilted_json_fixed(w, (int32_t)timestamp, 0);
+    }
+    tilted_json_end_object(w);
+    if (w.overflow)
+    {
+        TILTED_LOGE("JSON payload too large; dropping reading\n");
+        return 0;
+    }
 
-    Serial.printf("\nTLV name: %s chipId: %08x\n", name, (unsigned)view.header->chipId);
+    TILTED_LOGI("\nTLV name: %s chipId: %08x\n", name, (unsigned)view.header.chipId);
+    return w.len;
 }
@@ -2,12 +2,44 @@
 
 #include <Arduino.h>
 
+#include <esp_idf_version.h>
+#include <esp_now.h>
+#include <esp_wifi_types.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "frame_queue.h"
+#include "gravity_polynomial.h"
+#include "sensor_table.h"
+#include "tilted_compact.h"
+#include "tilted_protocol.h"
+
 // Simple ESP-NOW receiver wrapper.
 //
 // Contract:
 // - Call begin() once to initialize ESP-NOW receive mode.
-// - When a valid TLV packet arrives, it stages JSON (and some metadata).
-// - In loop(), call hasPending() / takePendingJson() to consume the staged JSON.
+// - Two-stage pipeline:
+//   1. The receive callback (WiFi task) only validates magic/length and
+//      copies the raw TLV frame, with its RSSI, channel and sender MAC,
+//      into rxQueue_.
+//   2. A worker task pinned to the other core decodes the frame, computes
+//      gravity and stages the JSON payload in txQueue_. Batch frames are
+//      split into one staged reading per set, each with its own timestamp.
+//      Compact (v2) frames are expanded to v1 frames the same way; their
+//      names come from the sensor table when the frame leaves them out.
+//      Readings whose sequence number was already seen (ESP-NOW retries,
+//      copies via a second gateway) are dropped here. A new reading that
+//      carries a stale ConfigVersion item gets a config frame straight back
+//      to its sender (see setSensorConfig()).
+// - Per-sensor state (name, sequence window, last reading, link quality,
+//   resolved polynomial) lives in a fixed-size SensorTable keyed by chipId.
+// - The receive RSSI is added to each live reading as an RssiDbm item, so
+//   it reaches the JSON payload and the spool. ESP-IDF 5 reports it to the
+//   callback; on IDF 4 (arduino-esp32 2.x) it comes from a promiscuous-mode
+//   callback that sees the same frame first, matched by sender MAC.
+// - In loop(), call hasPending() / peekPending() / popPending() to consume
+//   staged readings in place, one at a time.
 //
 class EspNowReceiver
 {
@@ -15,36 +47,246 @@ public:
     // Uses shared gateway MAC + shared ESPNOW channel constants.
     EspNowReceiver();
 
-    // Provide polynomial used for gravity calculation.
-    // If empty, gravity will not be computed.
-    void setPolynomial(const String& polynomial);
+    // Provide the default polynomial used for gravity calculation.
+    // It is compiled once here; if empty (or it fails to parse), gravity
+    // will not be computed for sensors without their own polynomial.
+    bool setPolynomial(const String& polynomial);
+
+    // Per-sensor calibration, keyed by chipId or by sensor name. Takes
+    // precedence over the default polynomial. An empty polynomial removes the
+    // override. Returns false on a parse error or if the table is full; on
+    // a parse error the sensor keeps the override it had.
+    bool setSensorPolynomial(uint32_t chipId, const String& polynomial);
+    bool setSensorPolynomial(const char* name, const String& polynomial);
+
+    // Replaces the whole set of overrides: set each one between begin and
+    // end, and end removes those that were not set again.
+    void beginSensorPolynomialUpdate();
+    void endSensorPolynomialUpdate();
+
+    // Settings for a sensor, keyed like the polynomials, sent in reply to its
+    // next frame that asks for them (see TiltedConfigHeader). spec is any of
+    //   interval=900 samples=10 tilt_deadband=0.1 temp_deadband=0.2
+    // separated by spaces or commas; settings left out use the sensor's
+    // defaults. An empty spec removes the entry. Returns false on a parse
+    // error or if the table is full.
+    bool setSensorConfig(uint32_t chipId, const String& spec);
+    bool setSensorConfig(const char* name, const String& spec);
+    void clearSensorConfigs();
 
     // Initializes WiFi STA + ESP-NOW, sets MAC/channel, registers callback.
     // Returns true on success.
     bool begin();
 
-    // True if a TLV reading has been decoded and JSON is ready.
+    // Coexistence mode: associates to the AP and keeps it, running ESP-NOW on
+    // the AP's channel instead of TILTED_ESPNOW_CHANNEL. Uplink then never
+    // needs to tear the radio down. Sensors find the channel by sweeping.
+    // Returns true if ESP-NOW is up (even if the AP is not reachable yet).
+    bool beginWithStation(const char* ssid, const char* password, uint32_t connectTimeoutMs);
+
+    // Config mode: brings the setup access point up next to ESP-NOW (AP+STA,
+    // both on TILTED_ESPNOW_CHANNEL), so readings keep arriving while the
+    // gateway is configured. Returns true if ESP-NOW is up.
+    bool beginWithAccessPoint(const char* ssid, const char* password);
+
+    // Channel the radio is currently receiving on.
+    uint8_t channel() const;
+
+    // True if a decoded JSON payload is staged.
     bool hasPending() const;
 
+    // Drops every staged JSON payload.
     void clearPending();
 
-    // Returns and clears the staged JSON payload.
-    // If no payload pending, returns empty string.
-    String takePendingJson();
+    // A staged reading: the raw TLV frame and its JSON payload (not
+    // null-terminated). Pointers stay valid until popPending().
+    struct PendingReading
+    {
+        uint32_t chipId;
+        uint32_t timestamp; // unix seconds the reading was taken, 0 = on arrival
+        const uint8_t* frame;
+        uint8_t frameLen;
+        const char* json;
+        uint16_t jsonLen;
+    };
+
+    // Returns false if nothing is pending.
+    bool peekPending(PendingReading& out) const;
+    void popPending();
+
+    // Encodes a raw TLV frame as a JSON payload, computing gravity. A non-zero
+    // timestamp (unix seconds) is added so the server can backdate replays.
+    // Safe to call from loop(). Returns bytes written, 0 on failure.
+    uint16_t encodeJson(const uint8_t* frame, uint16_t len, uint32_t timestamp, char* out, uint16_t outMax);
+
+    // Receive queue statistics, for sizing RX_QUEUE_SLOTS to the fleet.
+    uint8_t queueDepth() const { return rxQueue_.depth(); }
+    uint8_t queueHighWater() const { return rxQueue_.highWater(); }
+    uint32_t queueDrops() const { return rxQueue_.drops(); }
+
+    // Payloads dropped because loop() fell behind the worker.
+    uint32_t payloadDrops() const { return txQueue_.drops(); }
+
+    // Readings dropped as duplicates of one already staged.
+    uint32_t duplicateDrops() const { return duplicateDrops_; }
+
+    // Config frames sent to sensors that asked for settings.
+    uint32_t configReplies() const { return configReplies_; }
+
+    // Per-sensor statistics from the sensor table. Loss counts stay zero for
+    // sensors that do not number their readings. Returns false once index is
+    // past the last known sensor.
+    struct LinkStats
+    {
+        uint32_t chipId;
+        uint32_t lastSeenMs;
+        int8_t rssiDbm;    // last frame, 0 = unknown
+        float rssiAvgDbm;  // moving average, NAN = unknown
+        uint8_t channel;   // channel of the last frame
+        uint32_t received;
+        uint32_t lost;
+        uint32_t duplicates;
+        float lossPercent;
+        uint32_t silenceLimitS; // 0 = unknown
+        uint32_t outages;       // gaps well past silenceLimitS
+    };
+    bool linkStats(uint8_t index, LinkStats& out) const;
 
 private:
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    static void recvCb(const esp_now_recv_info_t* info, const uint8_t* incomingData, int len);
+#else
     static void recvCb(const uint8_t* senderMac, const uint8_t* incomingData, int len);
-    void onRecv(const uint8_t* senderMac, const uint8_t* incomingData, int len);
+    static void promiscuousCb(void* buf, wifi_promiscuous_pkt_type_t type);
+
+    // Link data of the last ESP-NOW frame promiscuousCb() saw, for recvCb().
+    struct LastRx
+    {
+        uint8_t mac[6];
+        int8_t rssiDbm;
+        uint8_t channel;
+    };
+    static LastRx lastRx_;
+#endif
+    // rssiDbm = 0 when it is unknown; channel = 0 for the current one.
+    void onRecv(const uint8_t* senderMac, int8_t rssiDbm, uint8_t channel, const uint8_t* incomingData, int len);
+
+    bool initEspNow();
+
+    static void workerTask(void* arg);
+    void processFrames();
+    // How a frame arrived.
+    struct RxInfo
+    {
+        int8_t rssiDbm; // 0 = unknown
+        uint8_t channel;
+        uint8_t mac[6]; // sender, all zero = unknown
+    };
+
+    void stageReading(const uint8_t* frame, uint16_t len, uint32_t timestamp, const RxInfo& rx);
+    void unpackBatch(const TiltedBatchView& batch, const RxInfo& rx);
+    void unpackCompact(const TiltedCompactView& compact, const RxInfo& rx);
+
+    // Name for a compact frame: its own, else the last one seen for its
+    // chipId. Returns the name length written to out (never empty).
+    uint8_t resolveName(const TiltedCompactView& compact, char* out);
+
+    // Worker-only: records the frame and its link quality in the sensor
+    // table and reserves its txQueue_ slot. Returns the slot, or nullptr if
+    // the frame is malformed, repeats a sequence number already seen from
+    // its sensor or the queue is full. haveSeq/seq give the frame's sequence
+    // number, which the caller passes to acceptSequence() once the slot is
+    // committed.
+    uint8_t* admitReading(const uint8_t* frame, uint16_t len, const RxInfo& rx, bool& haveSeq, uint32_t& seq);
+    void acceptSequence(uint32_t chipId, uint32_t seq);
+
+    // live = a reading arriving now (updates the sensor table), as opposed
+    // to a spooled frame re-encoded by encodeJson().
+    uint16_t encodeReading(const uint8_t* frame, uint16_t len, uint32_t timestamp, char* out, uint16_t outMax,
+                           bool live);
+
+    struct SensorPolynomial
+    {
+        bool used = false;
+        bool stale = false;                   // not set again since begin
+        uint32_t chipId = 0;                  // 0 when keyed by name
+        char name[TILTED_MAX_NAME_LEN + 1]{}; // empty when keyed by chipId
+        GravityPolynomial poly;
+    };
+
+    bool storeSensorPolynomial(uint32_t chipId, const char* name, const String& polynomial);
+
+    struct SensorConfig
+    {
+        bool used = false;
+        uint32_t chipId = 0;                  // 0 when keyed by name
+        char name[TILTED_MAX_NAME_LEN + 1]{}; // empty when keyed by chipId
+        uint16_t version = 0;
+        uint8_t itemCount = 0;
+        TiltedValueItem items[TILTED_MAX_CONFIG_ITEMS]{};
+    };
+
+    bool storeSensorConfig(uint32_t chipId, const char* name, const String& spec);
+    // Builds the reply to a sensor that reported settings version
+    // sensorVersion. stateMutex_ must be held. Returns the frame length, 0
+    // if the sensor is up to date.
+    uint16_t encodeConfigReply(uint32_t chipId, const char* name, uint16_t sensorVersion, uint8_t* out,
+                               uint16_t outMax);
+    // Worker-only: unicasts a frame to a sensor, adding it as a peer the
+    // first time.
+    void sendToSensor(const uint8_t* mac, const uint8_t* frame, uint16_t len);
+
+    // All must be called with stateMutex_ held. entry may be nullptr.
+    SensorPolynomial* findSensorPolynomial(uint32_t chipId, const char* name);
+    SensorConfig* findSensorConfig(uint32_t chipId, const char* name);
+    GravityPolynomial* sensorPolynomialFor(uint32_t chipId, const char* name, SensorTable::Entry* entry);
+    float evaluateGravity(uint32_t chipId, const char* name, SensorTable::Entry* entry, float tilt, float temp);
 
 private:
+    // Number of frames buffered between the receive callback and the worker.
+    // Must be a power of two.
+    static constexpr uint8_t RX_QUEUE_SLOTS = 16;
+    // ESP-NOW payloads are limited to 250 bytes (ESP_NOW_MAX_DATA_LEN).
+    static constexpr uint16_t RX_FRAME_MAX = 250;
+    // Each queued frame is prefixed with its RSSI, channel and sender MAC.
+    static constexpr uint16_t RX_SLOT_HEADER = 8;
+
+    // Number of JSON payloads buffered between the worker and loop().
+    static constexpr uint8_t TX_QUEUE_SLOTS = 8;
+    static constexpr uint16_t TX_PAYLOAD_MAX = 768;
+
+    // The WiFi stack (and therefore recvCb) runs on core 0; keep decoding off it.
+    static constexpr BaseType_t WORKER_CORE = 1;
+    static constexpr uint32_t WORKER_STACK_BYTES = 6144;
+    static constexpr UBaseType_t WORKER_PRIORITY = 2;
+
     uint8_t staMac_[6]{};
     uint8_t channel_ = 1;
 
-    String polynomial_;
+    // Maximum number of per-sensor polynomial overrides.
+    static constexpr uint8_t MAX_SENSOR_POLYNOMIALS = 8;
+    // Maximum number of per-sensor settings entries.
+    static constexpr uint8_t MAX_SENSOR_CONFIGS = 8;
+
+    // Guards the compiled polynomials, sensor settings and sensors_ between loop() and the worker.
+    SemaphoreHandle_t stateMutex_ = nullptr;
+    GravityPolynomial polynomial_;
+    SensorPolynomial sensorPolynomials_[MAX_SENSOR_POLYNOMIALS];
+    SensorConfig sensorConfigs_[MAX_SENSOR_CONFIGS];
+    // Bumped whenever sensorPolynomials_ changes; stale table entries
+    // look their polynomial up again.
+    uint16_t polyGeneration_ = 1;
+
+    SensorTable sensors_;
+    uint32_t duplicateDrops_ = 0;
+    uint32_t configReplies_ = 0;
+
+    // Raw TLV frames: filled by the ESP-NOW callback, drained by the worker.
+    FrameQueue<RX_QUEUE_SLOTS, RX_SLOT_HEADER + RX_FRAME_MAX> rxQueue_;
+    // JSON payloads: filled by the worker, drained by loop().
+    FrameQueue<TX_QUEUE_SLOTS, TX_PAYLOAD_MAX> txQueue_;
 
-    // Staged publish payload.
-    volatile bool havePending_ = false;
-    String pendingJson_;
+    TaskHandle_t worker_ = nullptr;
 
     // For debug/logging only.
     uint8_t lastSender_[6]{};
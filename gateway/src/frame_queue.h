@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+// Fixed-capacity, allocation-free single-producer/single-consumer frame queue.
+//
+// Contract:
+// - Exactly one producer calls push() (e.g. the ESP-NOW receive callback).
+// - Exactly one consumer calls front()/pop() (e.g. loop()).
+// - Frames are copied into fixed slots; a full queue drops the new frame and
+//   counts it in drops() rather than overwriting unread data.
+// - Producers that build a frame in place use reserve()/commit() instead of
+//   push(), which saves the intermediate copy.
+//
+// Usage:
+//   FrameQueue<16, 250> q;
+//   q.push(data, len);                      // producer
+//   uint16_t len;
+//   while (const uint8_t* f = q.front(len)) // consumer
+//   {
+//       handle(f, len);
+//       q.pop();
+//   }
+template <uint8_t Slots, uint16_t SlotBytes>
+class FrameQueue
+{
+    static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+    static_assert(SlotBytes > 0, "SlotBytes must be non-zero");
+
+public:
+    static constexpr uint8_t capacity() { return Slots; }
+    static constexpr uint16_t slotBytes() { return SlotBytes; }
+
+    // Producer side. Returns false (and counts a drop) if the frame does not
+    // fit in a slot or the queue is full.
+    bool push(const uint8_t* data, uint16_t len)
+    {
+        if (!data || len == 0 || len > SlotBytes)
+        {
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        const uint32_t used = head - tail;
+        if (used >= Slots)
+        {
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Slot& s = slots_[head & (Slots - 1)];
+        memcpy(s.data, data, len);
+        s.len = len;
+        head_.store(head + 1, std::memory_order_release);
+
+        // Only the producer writes the high-water mark.
+        if (used + 1 > highWater_.load(std::memory_order_relaxed))
+            highWater_.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Producer side. Returns the next free slot to write up to SlotBytes into,
+    // or nullptr (counting a drop) if the queue is full. Nothing is visible to
+    // the consumer until commit().
+    uint8_t* reserve()
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= Slots)
+        {
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return slots_[head & (Slots - 1)].data;
+    }
+
+    // Producer side. Publishes the slot returned by reserve(). len = 0 abandons it.
+    void commit(uint16_t len)
+    {
+        if (len == 0 || len > SlotBytes)
+            return;
+
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        slots_[head & (Slots - 1)].len = len;
+        head_.store(head + 1, std::memory_order_release);
+
+        const uint32_t used = head + 1 - tail_.load(std::memory_order_acquire);
+        if (used > highWater_.load(std::memory_order_relaxed))
+            highWater_.store(used, std::memory_order_relaxed);
+    }
+
+    // Consumer side. Returns a pointer to the oldest frame (valid until pop())
+    // or nullptr if the queue is empty.
+    const uint8_t* front(uint16_t& len) const
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail)
+        {
+            len = 0;
+            return nullptr;
+        }
+
+        const Slot& s = slots_[tail & (Slots - 1)];
+        len = s.len;
+        return s.data;
+    }
+
+    // Consumer side. Releases the oldest frame back to the producer.
+    void pop()
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail)
+            return;
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    // Consumer side. Drops every queued frame.
+    void clear()
+    {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Number of frames currently queued.
+    uint8_t depth() const
+    {
+        return (uint8_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+
+    // Deepest the queue has been since boot.
+    uint8_t highWater() const { return (uint8_t)highWater_.load(std::memory_order_relaxed); }
+
+    // Frames rejected because the queue was full (or the frame was oversized).
+    uint32_t drops() const { return drops_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        uint16_t len;
+        uint8_t data[SlotBytes];
+    };
+
+    Slot slots_[Slots]{};
+
+    // Free-running counters; index = counter & (Slots - 1).
+    std::atomic<uint32_t> head_{0}; // written by producer
+    std::atomic<uint32_t> tail_{0}; // written by consumer
+
+    std::atomic<uint32_t> highWater_{0};
+    std::atomic<uint32_t> drops_{0};
+};
@@ -0,0 +1,67 @@
+#include "gravity_polynomial.h"
+
+#include <tinyexpr.h>
+
+#include "tilted_log.h"
+
+GravityPolynomial::~GravityPolynomial()
+{
+    clear();
+}
+
+bool GravityPolynomial::compile(const String& expression)
+{
+    clear();
+    if (expression.isEmpty())
+        return true;
+
+    int err = 0;
+    te_variable vars[] = {{"tilt", &tilt_}, {"temp", &temp_}};
+    expr_ = te_compile(expression.c_str(), vars, 2, &err);
+    if (!expr_)
+    {
+        TILTED_LOGE("Could not compile polynomial '%s'. Parse error at %d\n", expression.c_str(), err);
+        return false;
+    }
+
+    expression_ = expression;
+    return true;
+}
+
+bool GravityPolynomial::parses(const String& expression)
+{
+    if (expression.isEmpty())
+        return true;
+
+    double tilt = 0, temp = 0;
+    int err = 0;
+    te_variable vars[] = {{"tilt", &tilt}, {"temp", &temp}};
+    te_expr* expr = te_compile(expression.c_str(), vars, 2, &err);
+    if (!expr)
+    {
+        TILTED_LOGE("Could not compile polynomial '%s'. Parse error at %d\n", expression.c_str(), err);
+        return false;
+    }
+    te_free(expr);
+    return true;
+}
+
+void GravityPolynomial::clear()
+{
+    if (expr_ != nullptr)
+    {
+        te_free(expr_);
+        expr_ = nullptr;
+    }
+    expression_ = String();
+}
+
+float GravityPolynomial::evaluate(float tilt, float temp)
+{
+    if (expr_ == nullptr)
+        return NAN;
+
+    tilt_ = tilt;
+    temp_ = temp;
+    return (float)te_eval(expr_);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct te_expr;
+
+// A gravity polynomial compiled once with tinyexpr and evaluated many times.
+//
+// The expression is compiled against two bound variables, `tilt` and `temp`,
+// which live inside this object. evaluate() just updates them and runs
+// te_eval(), so there is no parsing or heap traffic per packet.
+//
+// Usage:
+//   GravityPolynomial poly;
+//   poly.compile("0.5013885598189161 + 0.019948730468857152 *tilt");
+//   float sg = poly.evaluate(tilt, temp);
+//
+// Not copyable: the compiled expression holds pointers to tilt_/temp_.
+class GravityPolynomial
+{
+public:
+    GravityPolynomial() = default;
+    ~GravityPolynomial();
+
+    GravityPolynomial(const GravityPolynomial&) = delete;
+    GravityPolynomial& operator=(const GravityPolynomial&) = delete;
+
+    // Compiles expression, replacing any previous one.
+    // An empty expression clears the polynomial and returns true.
+    // On a parse error the polynomial is cleared and false is returned.
+    bool compile(const String& expression);
+
+    // True if expression would compile; logs the parse error like compile().
+    // Lets a caller keep a working polynomial rather than lose it to a typo.
+    static bool parses(const String& expression);
+
+    void clear();
+
+    bool valid() const { return expr_ != nullptr; }
+    const String& expression() const { return expression_; }
+
+    // Returns NAN if no expression is compiled.
+    float evaluate(float tilt, float temp);
+
+private:
+    te_expr* expr_ = nullptr;
+    String expression_;
+
+    // Bound variables referenced by expr_.
+    double tilt_ = 0;
+    double temp_ = 0;
+};
@@ -1,14 +1,17 @@
 #include "WiFi.h"
-#include <ArduinoJson.h>
-#include <HTTPClient.h>
-#include <WiFiClientSecure.h>
 #include <Preferences.h>
 #include <SPI.h>
 #include <CircularBuffer.h>
+#include <time.h>
 
 #include "tilted_protocol.h"
 #include "config_portal.h"
 #include "espnow_receiver.h"
+#include "tilted_log.h"
+#include "uplink_batcher.h"
+#include "uplink_client.h"
+#include "uplink_spool.h"
+#include "wall_clock.h"
 
 // Preferences
 Preferences preferences;
@@ -18,7 +21,16 @@ String deviceName = "";
 String wifiSSID = "";
 String wifiPassword = "";
 String polynomial = "";// somthing like "0.5013885598189161 + 0.019948730468857152 *tilt" use https://www.ispindel.de/tools/calibration/calibration.htm for calibration
+// Optional per-sensor polynomials: "key=expression" entries separated by ';' or newlines,
+// where key is a sensor name (e.g. "tilt-1a2b3c4d") or its 8-digit hex chipId.
+String sensorPolynomials = "";
+// Optional per-sensor settings pushed over the downlink: "key setting=value ..."
+// entries separated by ';' or newlines, keyed like sensorPolynomials, e.g.
+// "tilt-1a2b3c4d interval=900 samples=10 tilt_deadband=0.1 temp_deadband=0.2".
+String sensorConfigs = "";
 String brewfatherURL = "";
+// Keep the station associated and run ESP-NOW on the AP's channel (see EspNowReceiver::beginWithStation).
+bool wifiCoexist = false;
 
 // AP mode settings
 const char* apSSID = "Porter-Setup";
@@ -28,16 +40,31 @@ const char* apPassword = "beermeplease";
 bool configMode = false;
 
 #define RETRY_INTERVAL 5000
+#define WIFI_CONNECT_TIMEOUT 5000
+
+// Readings that arrive within this window (or until this many are queued)
+// are sent to the Tilted server as one JSON array.
+#define UPLINK_BATCH_WINDOW_MS 10000
+#define UPLINK_BATCH_MAX_ITEMS 8
+
+// Flash set aside for readings that could not be delivered to the Tilted
+// server (256 bytes per reading). When full, the oldest readings are dropped.
+#define UPLINK_SPOOL_BYTES (64 * 1024)
 
 // Hold this pin LOW during boot to force config/AP mode.
 // GPIO13 is currently unused by this firmware and not part of the display SPI pins (18/19/5/16/23/4).
 static constexpr int CONFIG_MODE_PIN = 13;
 
-// Use a secure WiFi client for HTTPS requests so SNI/TLS works correctly.
-WiFiClientSecure wifiClient;
+// Keep-alive uplink; TLS is only renegotiated when the connection drops, which
+// without wifiCoexist is after every drain.
+UplinkClient uplinkClient;
 
 EspNowReceiver espNow;
 
+UplinkBatcher uplinkBatcher;
+UplinkRateLimiter brewfatherRateLimiter;
+UplinkSpool uplinkSpool;
+
 ConfigPortal configPortal(preferences);
 
 static void ensureEspNow()
@@ -49,6 +76,15 @@ static void ensureEspNow()
     }
 }
 
+static void ensureEspNowWithStation()
+{
+    if (!espNow.beginWithStation(wifiSSID.c_str(), wifiPassword.c_str(), WIFI_CONNECT_TIMEOUT))
+    {
+        delay(RETRY_INTERVAL);
+        ESP.restart();
+    }
+}
+
 void wifiConnect()
 {
     WiFi.mode(WIFI_STA);
@@ -57,53 +93,152 @@ void wifiConnect()
     int attempts = 0;
     while (WiFi.status() != WL_CONNECTED && attempts < 20) {
         delay(250);
-        Serial.print(".");
+        TILTED_LOGI(".");
+        tilted_log_flush();
         attempts++;
     }
 
     if (WiFi.status() == WL_CONNECTED) {
-        Serial.print("\nWiFi connected, IP address: ");
-        Serial.println(WiFi.localIP());
+        TILTED_LOGI("\nWiFi connected, IP address: %s\n", WiFi.localIP().toString().c_str());
     } else {
-        Serial.println("\nWiFi connection failed");
+        TILTED_LOGE("\nWiFi connection failed\n");
     }
 }
 
-void publishBrewfather()
+// Brewfather's stream endpoint takes one reading per request and rate limits
+// per device. Anything else is assumed to be a Tilted server, whose
+// /api/publish endpoint accepts a JSON array and fans out to Brewfather itself.
+static bool isBrewfatherDirect()
 {
-    Serial.println("Sending to Brewfather...");
-    String jsonBody = espNow.takePendingJson();
+    String urlLower = brewfatherURL;
+    urlLower.toLowerCase();
+    return urlLower.indexOf("brewfather.net") >= 0;
+}
 
-    Serial.println("");
-    Serial.println("JSON Body:");
-    Serial.println(jsonBody);
-    Serial.println("");
+static int postJson(const char* body, uint16_t len)
+{
+    TILTED_LOGD("\nJSON Body:\n");
+    TILTED_LOGD_DATA(body, len);
+    TILTED_LOGD("\n");
 
-    HTTPClient http;
-    int httpCode = -1;
     String resp;
+    int httpCode = uplinkClient.post(body, len, &resp);
+    TILTED_LOGI("POST returned code=%d body=%s\n", httpCode, resp.c_str());
+    return httpCode;
+}
 
-    // Choose secure or insecure client based on URL scheme
-    String urlLower = brewfatherURL;
-    urlLower.toLowerCase();
-    if (urlLower.startsWith("https://")) {
-        // HTTPS: use WiFiClientSecure
-        wifiClient.setInsecure(); // skip cert validation if no CA available
-        http.begin(wifiClient, brewfatherURL.c_str());
-    } else if (urlLower.startsWith("http://")) {
-        // Plain HTTP: use default (non-secure) begin
-        http.begin(brewfatherURL.c_str());
-    } else {
-        // No scheme: assume HTTPS
-        wifiClient.setInsecure();
-        http.begin(wifiClient, brewfatherURL.c_str());
+static bool postSucceeded(int httpCode)
+{
+    return httpCode >= 200 && httpCode < 300;
+}
+
+static uint32_t currentEpoch()
+{
+    const time_t now = time(nullptr);
+    return (now >= EPOCH_VALID_AFTER) ? (uint32_t)now : 0;
+}
+
+// Keep a batch the server did not take, so it can be replayed later.
+static void spoolBatch()
+{
+    const uint32_t now = currentEpoch();
+    uint8_t spooled = 0;
+    for (uint8_t i = 0; i < uplinkBatcher.count(); i++)
+    {
+        uint8_t len = 0;
+        const uint8_t* frame = uplinkBatcher.frame(i, len);
+        // Readings unpacked from a sensor batch already carry their own time.
+        const uint32_t epoch = uplinkBatcher.timestamp(i) ? uplinkBatcher.timestamp(i) : now;
+        if (frame && uplinkSpool.append(frame, len, epoch))
+            spooled++;
     }
+    uplinkSpool.flush();
+    TILTED_LOGI("Spooled %u reading(s), %lu pending\n", (unsigned)spooled, (unsigned long)uplinkSpool.pending());
+    if (spooled != uplinkBatcher.count())
+        TILTED_LOGE("Spool: %u reading(s) dropped, %lu since boot\n", (unsigned)(uplinkBatcher.count() - spooled),
+                    (unsigned long)uplinkSpool.dropped());
+}
+
+// Send spooled readings, oldest first, as timestamped batches. Stops at the
+// first failed POST; those readings stay spooled.
+static void replaySpool()
+{
+    static uint8_t frame[UplinkSpool::FRAME_MAX];
+    static char json[768];
 
-    http.addHeader("Content-Type", "application/json");
-    httpCode = http.POST(jsonBody);
-    resp = http.getString();
-    Serial.printf("Brewfather POST returned code=%d body=%s\n", httpCode, resp.c_str());
-    http.end();
+    while (uplinkSpool.pending() && WiFi.status() == WL_CONNECTED)
+    {
+        uint32_t seq = uplinkSpool.tail();
+        while (seq != uplinkSpool.head() && !uplinkBatcher.full())
+        {
+            uint8_t len = 0;
+            uint32_t epoch = 0;
+            if (!uplinkSpool.read(seq, frame, len, epoch))
+            {
+                seq++;
+                continue;
+            }
+
+            const uint16_t n = espNow.encodeJson(frame, len, epoch, json, sizeof(json));
+            if (n != 0 && !uplinkBatcher.fits(n))
+                break;
+            if (n != 0)
+                uplinkBatcher.add(json, n);
+            seq++;
+        }
+
+        if (!uplinkBatcher.empty())
+        {
+            TILTED_LOGI("Replaying %u spooled reading(s)...\n", (unsigned)uplinkBatcher.count());
+            const int httpCode = postJson(uplinkBatcher.body(), uplinkBatcher.bodyLength());
+            uplinkBatcher.clear();
+            if (!postSucceeded(httpCode))
+                return;
+        }
+        uplinkSpool.consume(seq);
+    }
+}
+
+void publishBrewfather()
+{
+    if (uplinkBatcher.empty())
+        return;
+
+    if (isBrewfatherDirect())
+    {
+        TILTED_LOGI("Sending %u reading(s) to Brewfather...\n", (unsigned)uplinkBatcher.count());
+        for (uint8_t i = 0; i < uplinkBatcher.count(); i++)
+        {
+            // Checked again here: the batch may hold two readings from one sensor.
+            const uint32_t chipId = uplinkBatcher.chipId(i);
+            if (!brewfatherRateLimiter.allow(chipId, millis()))
+                continue;
+            uint16_t len = 0;
+            const char* item = uplinkBatcher.item(i, len);
+            // A failed POST leaves the interval open, so the sensor's next
+            // reading goes out instead.
+            if (WiFi.status() == WL_CONNECTED && postSucceeded(postJson(item, len)))
+                brewfatherRateLimiter.record(chipId, millis());
+        }
+    }
+    else
+    {
+        TILTED_LOGI("Sending batch of %u reading(s)...\n", (unsigned)uplinkBatcher.count());
+        const bool sent = (WiFi.status() == WL_CONNECTED) &&
+                          postSucceeded(postJson(uplinkBatcher.body(), uplinkBatcher.bodyLength()));
+        if (!sent)
+        {
+            spoolBatch();
+            uplinkBatcher.clear();
+            return;
+        }
+        uplinkBatcher.clear();
+
+        // The uplink is back; catch up on anything that was spooled.
+        replaySpool();
+        return;
+    }
+    uplinkBatcher.clear();
 }
 
 String macToString(const uint8_t* mac) {
@@ -117,6 +252,88 @@ bool integrationEnabled(String integration) {
     return !integration.isEmpty();
 }
 
+static bool isHexChipId(const String& key) {
+    if (key.length() != 8)
+        return false;
+    for (unsigned i = 0; i < key.length(); i++) {
+        if (!isxdigit((unsigned char)key[i]))
+            return false;
+    }
+    return true;
+}
+
+// Next non-empty entry of a ';' or newline separated spec, trimmed.
+// Start with start = 0; returns false after the last entry.
+static bool nextSpecEntry(const String& spec, int& start, String& entry) {
+    while (start < (int)spec.length()) {
+        int end = start;
+        while (end < (int)spec.length() && spec[end] != ';' && spec[end] != '\n')
+            end++;
+
+        entry = spec.substring(start, end);
+        start = end + 1;
+        entry.trim();
+        if (!entry.isEmpty())
+            return true;
+    }
+    return false;
+}
+
+// Compile the per-sensor polynomials (see sensorPolynomials) into the receiver.
+// An entry that fails to parse keeps the sensor's previous polynomial.
+void applySensorPolynomials(const String& spec) {
+    espNow.beginSensorPolynomialUpdate();
+
+    int start = 0;
+    String entry;
+    while (nextSpecEntry(spec, start, entry)) {
+
+        int eq = entry.indexOf('=');
+        if (eq <= 0) {
+            TILTED_LOGE("Ignoring sensor polynomial without key: %s\n", entry.c_str());
+            continue;
+        }
+
+        String key = entry.substring(0, eq);
+        String expr = entry.substring(eq + 1);
+        key.trim();
+        expr.trim();
+
+        bool ok = isHexChipId(key)
+            ? espNow.setSensorPolynomial((uint32_t)strtoul(key.c_str(), nullptr, 16), expr)
+            : espNow.setSensorPolynomial(key.c_str(), expr);
+        TILTED_LOGI("Sensor polynomial %s: %s\n", key.c_str(), ok ? "ok" : "rejected");
+    }
+    espNow.endSensorPolynomialUpdate();
+}
+
+// Hand the per-sensor settings (see sensorConfigs) to the receiver, which
+// sends them to each sensor the next time it asks.
+void applySensorConfigs(const String& spec) {
+    espNow.clearSensorConfigs();
+
+    int start = 0;
+    String entry;
+    while (nextSpecEntry(spec, start, entry)) {
+        int space = 0;
+        while (space < (int)entry.length() && !isspace((unsigned char)entry[space]))
+            space++;
+
+        String key = entry.substring(0, space);
+        String settings = entry.substring(space);
+        settings.trim();
+        if (settings.isEmpty()) {
+            TILTED_LOGE("Ignoring sensor settings without values: %s\n", entry.c_str());
+            continue;
+        }
+
+        bool ok = isHexChipId(key)
+            ? espNow.setSensorConfig((uint32_t)strtoul(key.c_str(), nullptr, 16), settings)
+            : espNow.setSensorConfig(key.c_str(), settings);
+        TILTED_LOGI("Sensor settings %s: %s\n", key.c_str(), ok ? "ok" : "rejected");
+    }
+}
+
 // Load settings from Preferences
 void loadSettings() {
     preferences.begin("tilted", false);
@@ -125,29 +342,73 @@ void loadSettings() {
     wifiSSID = preferences.getString("wifiSSID", "");
     wifiPassword = preferences.getString("wifiPassword", "");
     polynomial = preferences.getString("polynomial", "");
+    sensorPolynomials = preferences.getString("sensorPolys", "");
+    sensorConfigs = preferences.getString("sensorConfigs", "");
     brewfatherURL = preferences.getString("brewfatherURL", "");
+    wifiCoexist = preferences.getBool("wifiCoexist", false);
     
     preferences.end();
     
-    Serial.println("Settings loaded:");
-    Serial.println("Device Name: " + deviceName);
-    Serial.println("WiFi SSID: " + wifiSSID);
-    Serial.println("Polynomial: " + polynomial);
-
-    // Make sure the ESP-NOW module has the latest polynomial so it can compute gravity in-callback.
+    TILTED_LOGI("Settings loaded:\n");
+    TILTED_LOGI("Device Name: %s\n", deviceName.c_str());
+    TILTED_LOGI("WiFi SSID: %s\n", wifiSSID.c_str());
+    TILTED_LOGI("Polynomial: %s\n", polynomial.c_str());
+    TILTED_LOGI("Keep WiFi connected: %s\n", wifiCoexist ? "yes" : "no");
+
+    // Make sure the ESP-NOW module has the latest polynomials so its worker can compute gravity.
+    // They are compiled once here rather than per packet.
     espNow.setPolynomial(polynomial);
+    applySensorPolynomials(sensorPolynomials);
+    applySensorConfigs(sensorConfigs);
 }
 
-// Start AP mode and web server (moved to ConfigPortal)
+// Normal operation: ESP-NOW with the uplink torn down between publishes, or
+// alongside a kept station (wifiCoexist).
+static void startReceiving() {
+    // Disconnect from AP before initializing ESP-Now.
+    // This is needed because IoTWebConf for some reason sets up the AP with init().
+    //WiFi.softAPdisconnect(true);
+    if (wifiCoexist)
+    {
+        ensureEspNowWithStation();
+    }
+    else
+    {
+        ensureEspNow();
+    }
+}
+
+// Start the setup AP and web server (see ConfigPortal). ESP-NOW keeps
+// receiving on the AP's channel.
 void startConfigMode() {
-    WiFi.disconnect();
     configMode = true;
-    espNow.clearPending();
+    if (!espNow.beginWithAccessPoint(apSSID, apPassword))
+        TILTED_LOGE("ESP-NOW not receiving while in config mode\n");
     configPortal.setApCredentials(apSSID, apPassword);
-    configPortal.start(deviceName, wifiSSID, wifiPassword, polynomial, brewfatherURL);
+    configPortal.start(deviceName, wifiSSID, wifiPassword, polynomial, sensorPolynomials, sensorConfigs, brewfatherURL,
+                       wifiCoexist);
+}
 
-    // While in config mode the polynomial may change; keep receiver updated.
+// Puts settings saved in the portal into effect, without a restart. The
+// portal closes once there is a network to join, unless the config pin is
+// still held.
+static void applySavedSettings() {
     espNow.setPolynomial(polynomial);
+    applySensorPolynomials(sensorPolynomials);
+    applySensorConfigs(sensorConfigs);
+    uplinkClient.setUrl(brewfatherURL);
+    if (!isBrewfatherDirect() && !uplinkSpool.ready())
+        uplinkSpool.begin(UPLINK_SPOOL_BYTES);
+    uplinkBatcher.setLimits(isBrewfatherDirect() ? 0 : UPLINK_BATCH_WINDOW_MS, UPLINK_BATCH_MAX_ITEMS);
+
+    if (wifiSSID.isEmpty() || digitalRead(CONFIG_MODE_PIN) == LOW) {
+        TILTED_LOGI("Settings applied, staying in config mode\n");
+        return;
+    }
+    TILTED_LOGI("Settings applied, leaving config mode\n");
+    configPortal.stop();
+    configMode = false;
+    startReceiving();
 }
 
 void setup()
@@ -160,35 +421,166 @@ void setup()
     // Load settings
     loadSettings();
 
+    uplinkClient.setUrl(brewfatherURL);
+
+    // Readings are spooled with their capture time so replays can be backdated.
+    configTime(0, 0, "pool.ntp.org");
+    if (!isBrewfatherDirect())
+        uplinkSpool.begin(UPLINK_SPOOL_BYTES);
+
+    // Brewfather-direct sends each reading on its own, so batching only adds latency there.
+    uplinkBatcher.setLimits(isBrewfatherDirect() ? 0 : UPLINK_BATCH_WINDOW_MS, UPLINK_BATCH_MAX_ITEMS);
+
     if (forceConfigMode || wifiSSID.isEmpty()) {
         if (forceConfigMode)
         {
-            Serial.println("Forcing config mode (GPIO13 held low)");
+            TILTED_LOGI("Forcing config mode (GPIO13 held low)\n");
         }
         startConfigMode();
     } else {
-        // Disconnect from AP before initializing ESP-Now.
-        // This is needed because IoTWebConf for some reason sets up the AP with init().
-        //WiFi.softAPdisconnect(true);
-        ensureEspNow();
+        startReceiving();
+    }
+}
+
+// Move staged payloads from the receiver into the uplink batch. Returns true
+// once the batch should be sent.
+static bool collectPending()
+{
+    if (!integrationEnabled(brewfatherURL))
+    {
+        espNow.clearPending();
+        return false;
+    }
+
+    const bool direct = isBrewfatherDirect();
+    while (!uplinkBatcher.full())
+    {
+        EspNowReceiver::PendingReading pending;
+        if (!espNow.peekPending(pending))
+            break;
+
+        // If the batch buffer is full the reading stays staged and leads the next batch.
+        if (!uplinkBatcher.fits(pending.jsonLen, pending.frameLen))
+            return true;
+
+        // Brewfather logs at arrival time; an older reading from a sensor batch
+        // would only use up the sensor's rate-limit slot.
+        if (direct && pending.timestamp != 0)
+        {
+            espNow.popPending();
+            continue;
+        }
+
+        if (direct && !brewfatherRateLimiter.allow(pending.chipId, millis()))
+        {
+            TILTED_LOGI("Skipping reading from %08x: Brewfather rate limit\n", (unsigned)pending.chipId);
+            espNow.popPending();
+            continue;
+        }
+
+        // Copied once, into the buffer that is sent. The raw frame rides along
+        // in case the batch has to be spooled.
+        uplinkBatcher.add(pending.json, pending.jsonLen, pending.frame, pending.frameLen, pending.timestamp,
+                          pending.chipId);
+        espNow.popPending();
+    }
+
+    return uplinkBatcher.due(millis());
+}
+
+// Publish the due batch, plus any that fill up or come due while we are
+// connected. A batch that is not due yet keeps collecting.
+static void drainPending()
+{
+    do
+    {
+        publishBrewfather();
+    } while (collectPending());
+
+    TILTED_LOGI("RX queue: depth=%u high=%u drops=%lu payload drops=%lu duplicates=%lu config replies=%lu\n",
+                  (unsigned)espNow.queueDepth(),
+                  (unsigned)espNow.queueHighWater(),
+                  (unsigned long)espNow.queueDrops(),
+                  (unsigned long)espNow.payloadDrops(),
+                  (unsigned long)espNow.duplicateDrops(),
+                  (unsigned long)espNow.configReplies());
+
+    EspNowReceiver::LinkStats link{};
+    for (uint8_t i = 0; espNow.linkStats(i, link); i++)
+    {
+        const unsigned long seenS = (millis() - link.lastSeenMs) / 1000;
+        TILTED_LOGI("Sensor %08x: seen %lu s ago%s ch=%u rssi=%d avg=%.1f received=%lu lost=%lu (%.1f%%) duplicates=%lu"
+                    " heartbeat=%lu s outages=%lu\n",
+                      (unsigned)link.chipId,
+                      seenS,
+                      (link.silenceLimitS != 0 && seenS > link.silenceLimitS + link.silenceLimitS / 2) ? " (overdue)" : "",
+                      (unsigned)link.channel,
+                      (int)link.rssiDbm,
+                      link.rssiAvgDbm,
+                      (unsigned long)link.received,
+                      (unsigned long)link.lost,
+                      link.lossPercent,
+                      (unsigned long)link.duplicates,
+                      (unsigned long)link.silenceLimitS,
+                      (unsigned long)link.outages);
     }
 }
 
 void loop()
 {
+    // Top of loop() is the idle point: nothing is waiting on us here.
+    tilted_log_flush();
+
     if (configMode)
     {
         configPortal.handle();
+        if (configPortal.takeSaved())
+            applySavedSettings();
+        // No uplink while configuring: server readings go to the spool and
+        // are replayed later; Brewfather-direct ones are held in
+        // uplinkBatcher until the portal closes.
+        if (configMode && collectPending() && !isBrewfatherDirect())
+        {
+            spoolBatch();
+            uplinkBatcher.clear();
+        }
+        return;
     }
 
-    if (espNow.hasPending())
+    if (wifiCoexist)
     {
-        wifiConnect();
-        if (integrationEnabled(brewfatherURL))
+        // The station stays associated (auto-reconnect handles drops), so we
+        // publish in place and ESP-NOW never stops receiving. While the AP is
+        // away, server batches are spooled to flash; Brewfather-direct
+        // readings stay in uplinkBatcher (collectPending() moved them there),
+        // and only once it is full do new ones back up in the receiver.
+        static uint8_t lastChannel = 0;
+        const uint8_t channel = espNow.channel();
+        if (channel != lastChannel)
         {
-            publishBrewfather();
+            TILTED_LOGI("ESP-NOW receiving on channel %u\n", (unsigned)channel);
+            lastChannel = channel;
         }
 
+        if (collectPending() && (WiFi.status() == WL_CONNECTED || !isBrewfatherDirect()))
+        {
+            drainPending();
+        }
+        return;
+    }
+
+    if (collectPending())
+    {
+        wifiConnect();
+        drainPending();
+        TILTED_LOGI("Uplink: %lu handshakes, %lu reused posts\n",
+                      (unsigned long)uplinkClient.handshakes(),
+                      (unsigned long)uplinkClient.reusedPosts());
+        // The station is torn down by begin(), so the connection cannot
+        // survive to the next drain: in this mode keep-alive only helps
+        // within one drain, and the next one pays for a full TLS handshake
+        // again. wifiCoexist keeps the connection across drains.
+        uplinkClient.stop();
         ensureEspNow();
     }
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "sensor_table.h"
+
+#include "tilted_log.h"
+
+int8_t SensorTable::slotOf(uint32_t chipId) const
+{
+    uint8_t slot = home(chipId);
+    for (uint8_t probes = 0; probes < SLOTS; probes++)
+    {
+        if (!used_[slot])
+            return -1;
+        if (entries_[slot].chipId == chipId)
+            return (int8_t)slot;
+        slot = (slot + 1) & (SLOTS - 1);
+    }
+    return -1;
+}
+
+SensorTable::Entry* SensorTable::find(uint32_t chipId)
+{
+    const int8_t slot = slotOf(chipId);
+    return (slot < 0) ? nullptr : &entries_[slot];
+}
+
+const SensorTable::Entry* SensorTable::find(uint32_t chipId) const
+{
+    const int8_t slot = slotOf(chipId);
+    return (slot < 0) ? nullptr : &entries_[slot];
+}
+
+SensorTable::Entry& SensorTable::touch(uint32_t chipId, uint32_t nowMs)
+{
+    Entry* e = find(chipId);
+    if (!e)
+    {
+        if (count_ >= MAX_SENSORS)
+            evictOldest();
+
+        uint8_t slot = home(chipId);
+        while (used_[slot])
+            slot = (slot + 1) & (SLOTS - 1);
+
+        e = &entries_[slot];
+        *e = Entry{};
+        e->chipId = chipId;
+        e->tilt = NAN;
+        e->temp = NAN;
+        e->gravity = NAN;
+        used_[slot] = true;
+        count_++;
+    }
+
+    e->lastSeenMs = nowMs;
+    e->lastUse = ++clock_;
+    return *e;
+}
+
+const SensorTable::Entry* SensorTable::at(uint8_t index) const
+{
+    for (uint8_t slot = 0; slot < SLOTS; slot++)
+    {
+        if (used_[slot] && index-- == 0)
+            return &entries_[slot];
+    }
+    return nullptr;
+}
+
+void SensorTable::evictOldest()
+{
+    int8_t oldest = -1;
+    for (uint8_t slot = 0; slot < SLOTS; slot++)
+    {
+        // Unsigned difference keeps the order right across clock_ wrap.
+        if (used_[slot] && (oldest < 0 || (clock_ - entries_[slot].lastUse) > (clock_ - entries_[oldest].lastUse)))
+            oldest = (int8_t)slot;
+    }
+    if (oldest < 0)
+        return;
+
+    TILTED_LOGI("Sensor table full; forgetting %08x\n", (unsigned)entries_[oldest].chipId);
+    evictions_++;
+    erase((uint8_t)oldest);
+}
+
+// Backward-shift deletion: pull later members of the probe run into the gap
+// so lookups never stop early at a hole.
+void SensorTable::erase(uint8_t slot)
+{
+    used_[slot] = false;
+    count_--;
+
+    uint8_t gap = slot;
+    uint8_t next = (slot + 1) & (SLOTS - 1);
+    while (used_[next])
+    {
+        const uint8_t want = home(entries_[next].chipId);
+        // Move next into the gap unless its home lies cyclically in (gap, next].
+        const bool stays = (gap <= next) ? (gap < want && want <= next) : (gap < want || want <= next);
+        if (!stays)
+        {
+            entries_[gap] = entries_[next];
+            used_[gap] = true;
+            used_[next] = false;
+            gap = next;
+        }
+        next = (next + 1) & (SLOTS - 1);
+    }
+}
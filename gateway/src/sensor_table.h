@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gravity_polynomial.h"
+#include "sequence_window.h"
+#include "tilted_protocol.h"
+
+// Fixed-capacity state per sensor, keyed by chipId.
+//
+// Open addressing with linear probing over a power-of-two slot array in
+// static storage: lookups hash the chipId and usually touch one slot, with no
+// allocation, so the table is safe to use from the ESP-NOW worker. The load
+// is capped at MAX_SENSORS; beyond that the least recently seen sensor is
+// evicted (backward-shift deletion, so no tombstones build up).
+//
+// Not thread-safe: the owner serialises access.
+//
+// Usage:
+//   SensorTable table;
+//   SensorTable::Entry& e = table.touch(chipId, millis());
+//   if (!e.sequence.accept(seq)) { /* duplicate */ }
+//   if (SensorTable::Entry* s = table.find(chipId)) { ... }
+class SensorTable
+{
+public:
+    static constexpr uint8_t SLOTS = 32; // power of two
+    static constexpr uint8_t MAX_SENSORS = SLOTS * 3 / 4;
+
+    struct Entry
+    {
+        uint32_t chipId;
+        uint32_t lastSeenMs;
+
+        // Name from the sensor's last frame that carried one.
+        uint8_t nameLen;
+        char name[TILTED_MAX_NAME_LEN];
+
+        // Last reading (NAN / 0 if not reported).
+        float tilt;
+        float temp;
+        float gravity;
+        int32_t batteryMv;
+
+        // Link quality. rssiAvg16 is an exponential moving average in 1/16 dBm
+        // (see addRssi()); 0 = no RSSI seen yet.
+        int8_t rssiDbm; // last frame, 0 = unknown
+        int16_t rssiAvg16;
+        uint8_t channel;
+
+        SequenceWindow sequence;
+
+        // Longest the sensor said it may stay silent (its heartbeat, else its
+        // interval), and how often it has been silent for clearly longer.
+        uint32_t silenceLimitS; // 0 = unknown
+        uint32_t outages;
+
+        // Polynomial this sensor resolved to, cached by the owner; valid
+        // while polyGeneration matches the owner's. nullptr = default.
+        GravityPolynomial* poly;
+        uint16_t polyGeneration;
+
+        uint32_t lastUse; // LRU stamp; owned by the table
+    };
+
+    // Folds one RSSI sample into e's moving average (weight 1/8, so it
+    // follows a sensor drifting out of range over a few readings).
+    static void addRssi(Entry& e, int8_t rssiDbm)
+    {
+        if (rssiDbm == 0)
+            return;
+        e.rssiDbm = rssiDbm;
+        if (e.rssiAvg16 == 0)
+            e.rssiAvg16 = (int16_t)(rssiDbm * 16);
+        else
+            e.rssiAvg16 = (int16_t)(e.rssiAvg16 + (rssiDbm * 16 - e.rssiAvg16) / 8);
+    }
+
+    static float rssiAverage(const Entry& e) { return e.rssiAvg16 ? e.rssiAvg16 / 16.0f : NAN; }
+
+    // Returns the entry for chipId, or nullptr. Does not count as a use.
+    Entry* find(uint32_t chipId);
+    const Entry* find(uint32_t chipId) const;
+
+    // Returns the entry for chipId, creating it (and evicting the least
+    // recently seen sensor if full) as needed, and marks it seen at nowMs.
+    Entry& touch(uint32_t chipId, uint32_t nowMs);
+
+    // Live entries in slot order, for statistics. Returns nullptr past the end.
+    const Entry* at(uint8_t index) const;
+
+    uint8_t size() const { return count_; }
+    uint32_t evictions() const { return evictions_; }
+
+private:
+    static uint8_t home(uint32_t chipId)
+    {
+        // Fibonacci hashing; chip ids share their vendor bits.
+        return (uint8_t)((chipId * 2654435761UL) >> 27) & (SLOTS - 1);
+    }
+    static_assert((SLOTS & (SLOTS - 1)) == 0 && (1u << (32 - 27)) == SLOTS, "home() assumes 32 slots");
+
+    int8_t slotOf(uint32_t chipId) const;
+    void evictOldest();
+    void erase(uint8_t slot);
+
+    Entry entries_[SLOTS]{};
+    bool used_[SLOTS]{};
+    uint8_t count_ = 0;
+    uint32_t clock_ = 0;
+    uint32_t evictions_ = 0;
+};
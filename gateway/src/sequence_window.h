@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tracks one sensor's reading sequence numbers for duplicate suppression and
+// loss accounting.
+//
+// Sensors number their readings from 1 after power-on (the counter lives in
+// RTC memory). The window remembers the newest number and which of the 31
+// before it have been seen, so ESP-NOW retries and copies relayed by a second
+// gateway are caught even when they arrive out of order. A gap counts as lost
+// until the missing reading turns up late.
+//
+// Usage:
+//   SequenceWindow w;
+//   if (!w.accept(seq)) { /* duplicate: drop before it costs an uplink */ }
+//   if (w.seen(seq)) { /* same test, without recording seq */ }
+//   w.lost(); w.received(); w.duplicates();
+class SequenceWindow
+{
+public:
+    static constexpr uint32_t WINDOW = 32;
+
+    // Returns false if seq was already seen.
+    bool accept(uint32_t seq)
+    {
+        if (received_ == 0 || restarted(seq))
+        {
+            // First reading, or the sensor lost its RTC memory and counts
+            // from 1 again.
+            newest_ = seq;
+            seen_ = 1;
+            received_++;
+            return true;
+        }
+
+        if (seq > newest_)
+        {
+            const uint32_t gap = seq - newest_;
+            lost_ += gap - 1;
+            seen_ = (gap >= WINDOW) ? 1 : ((seen_ << gap) | 1);
+            newest_ = seq;
+            received_++;
+            return true;
+        }
+
+        const uint32_t age = newest_ - seq;
+        const uint32_t bit = 1UL << age;
+        if (seen_ & bit)
+        {
+            duplicates_++;
+            return false;
+        }
+
+        // Late arrival of a reading that was counted as lost.
+        seen_ |= bit;
+        if (lost_)
+            lost_--;
+        received_++;
+        return true;
+    }
+
+    // True if accept(seq) would reject seq. Changes nothing.
+    bool seen(uint32_t seq) const
+    {
+        if (received_ == 0 || restarted(seq) || seq > newest_)
+            return false;
+        return (seen_ & (1UL << (newest_ - seq))) != 0;
+    }
+
+    uint32_t newest() const { return newest_; }
+    uint32_t received() const { return received_; }
+    uint32_t lost() const { return lost_; }
+    uint32_t duplicates() const { return duplicates_; }
+
+    // Lost readings as a share of all readings the sensor numbered, in percent.
+    float lossPercent() const
+    {
+        const uint32_t total = received_ + lost_;
+        return total ? (100.0f * (float)lost_ / (float)total) : 0.0f;
+    }
+
+private:
+    // Older than the window can tell, or a sensor that counts from 1 again.
+    bool restarted(uint32_t seq) const
+    {
+        return seq < newest_ && (seq == 1 || newest_ - seq >= WINDOW);
+    }
+
+    uint32_t newest_ = 0;
+    uint32_t seen_ = 0; // bit i: newest_ - i has been seen
+    uint32_t received_ = 0;
+    uint32_t lost_ = 0;
+    uint32_t duplicates_ = 0;
+};
@@ -0,0 +1,140 @@
+#include "uplink_batcher.h"
+
+UplinkBatcher::UplinkBatcher()
+{
+    clear();
+}
+
+void UplinkBatcher::setLimits(uint32_t windowMs, uint8_t maxItems)
+{
+    windowMs_ = windowMs;
+    if (maxItems == 0)
+        maxItems = 1;
+    maxItems_ = (maxItems > MAX_ITEMS) ? MAX_ITEMS : maxItems;
+}
+
+bool UplinkBatcher::fits(uint16_t len, uint8_t frameLen) const
+{
+    if (full() || (uint32_t)framesLen_ + frameLen > FRAMES_MAX)
+        return false;
+    // Room for a separator and the closing ']'.
+    const uint16_t sep = count_ ? 1 : 0;
+    return (uint32_t)len_ + sep + len + 1 <= BODY_MAX;
+}
+
+bool UplinkBatcher::add(const char* json, uint16_t len, const uint8_t* frame, uint8_t frameLen, uint32_t timestamp,
+                        uint32_t chipId)
+{
+    if (!frame)
+        frameLen = 0;
+    if (!json || len == 0 || !fits(len, frameLen))
+        return false;
+
+    const uint16_t sep = count_ ? 1 : 0;
+
+    if (sep)
+        buf_[len_++] = ',';
+    offsets_[count_] = len_;
+    lengths_[count_] = len;
+    memcpy(buf_ + len_, json, len);
+    len_ += len;
+
+    timestamps_[count_] = timestamp;
+    chipIds_[count_] = chipId;
+    frameOffsets_[count_] = framesLen_;
+    frameLengths_[count_] = frameLen;
+    if (frameLen)
+    {
+        memcpy(frames_ + framesLen_, frame, frameLen);
+        framesLen_ += frameLen;
+    }
+
+    if (count_ == 0)
+        firstMs_ = millis();
+    count_++;
+    return true;
+}
+
+bool UplinkBatcher::due(uint32_t nowMs) const
+{
+    if (count_ == 0)
+        return false;
+    return full() || (nowMs - firstMs_) >= windowMs_;
+}
+
+const char* UplinkBatcher::body()
+{
+    buf_[len_] = ']';
+    buf_[len_ + 1] = '\0';
+    return buf_;
+}
+
+const char* UplinkBatcher::item(uint8_t i, uint16_t& len) const
+{
+    if (i >= count_)
+    {
+        len = 0;
+        return nullptr;
+    }
+    len = lengths_[i];
+    return buf_ + offsets_[i];
+}
+
+const uint8_t* UplinkBatcher::frame(uint8_t i, uint8_t& len) const
+{
+    if (i >= count_ || frameLengths_[i] == 0)
+    {
+        len = 0;
+        return nullptr;
+    }
+    len = frameLengths_[i];
+    return frames_ + frameOffsets_[i];
+}
+
+void UplinkBatcher::clear()
+{
+    buf_[0] = '[';
+    len_ = 1;
+    count_ = 0;
+    framesLen_ = 0;
+    firstMs_ = 0;
+}
+
+bool UplinkRateLimiter::allow(uint32_t chipId, uint32_t nowMs, uint32_t intervalMs) const
+{
+    for (const auto& e : entries_)
+    {
+        if (e.used && e.chipId == chipId)
+            return (nowMs - e.lastMs) >= intervalMs;
+    }
+    return true;
+}
+
+void UplinkRateLimiter::record(uint32_t chipId, uint32_t nowMs)
+{
+    Entry* slot = nullptr;
+    Entry* oldest = nullptr;
+    for (auto& e : entries_)
+    {
+        if (!e.used)
+        {
+            if (!slot)
+                slot = &e;
+            continue;
+        }
+        if (e.chipId == chipId)
+        {
+            e.lastMs = nowMs;
+            return;
+        }
+        if (!oldest || (nowMs - e.lastMs) > (nowMs - oldest->lastMs))
+            oldest = &e;
+    }
+
+    // Unknown sensor: take a free entry, or recycle the least recently sent one.
+    if (!slot)
+        slot = oldest;
+    slot->used = true;
+    slot->chipId = chipId;
+    slot->lastMs = nowMs;
+}
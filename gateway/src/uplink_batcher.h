@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Collects staged reading payloads so several sensors' readings can go out in
+// one HTTP POST.
+//
+// Items are stored back to back in a fixed buffer already laid out as a JSON
+// array ("[a,b,c]"), so the batch is sent without building another copy.
+// Individual items stay addressable for endpoints that only accept one reading
+// per request (Brewfather-direct). Each item can also carry the raw TLV frame
+// it was encoded from, so a batch that fails to send can be spooled compactly.
+//
+// Usage:
+//   UplinkBatcher batcher;
+//   batcher.setLimits(10000, 8);
+//   batcher.add(json, len);
+//   if (batcher.due(millis())) {
+//     post(batcher.body(), batcher.bodyLength());
+//     batcher.clear();
+//   }
+class UplinkBatcher
+{
+public:
+    static constexpr uint8_t MAX_ITEMS = 16;
+    static constexpr uint16_t BODY_MAX = 2048;
+    static constexpr uint16_t FRAMES_MAX = 1536;
+
+    UplinkBatcher();
+
+    // A batch is due windowMs after its first item arrived, or as soon as it
+    // holds maxItems items. windowMs = 0 makes every batch due immediately.
+    void setLimits(uint32_t windowMs, uint8_t maxItems);
+
+    // Appends one JSON object, optionally with its raw frame, the unix time it
+    // was taken (0 = on arrival) and the sensor it came from. Returns false if
+    // it does not fit; the caller should flush and retry.
+    bool add(const char* json, uint16_t len, const uint8_t* frame = nullptr, uint8_t frameLen = 0,
+             uint32_t timestamp = 0, uint32_t chipId = 0);
+
+    // True if add() would accept an item of len bytes (plus frameLen frame bytes).
+    bool fits(uint16_t len, uint8_t frameLen = 0) const;
+
+    bool due(uint32_t nowMs) const;
+    bool full() const { return count_ >= maxItems_; }
+    bool empty() const { return count_ == 0; }
+    uint8_t count() const { return count_; }
+
+    // The whole batch as a JSON array.
+    const char* body();
+    uint16_t bodyLength() const { return count_ ? (uint16_t)(len_ + 1) : 0; }
+
+    // Item i as a standalone JSON object.
+    const char* item(uint8_t i, uint16_t& len) const;
+
+    // Raw frame of item i, or nullptr if it was added without one.
+    const uint8_t* frame(uint8_t i, uint8_t& len) const;
+    uint32_t timestamp(uint8_t i) const { return (i < count_) ? timestamps_[i] : 0; }
+    uint32_t chipId(uint8_t i) const { return (i < count_) ? chipIds_[i] : 0; }
+
+    void clear();
+
+private:
+    char buf_[BODY_MAX + 1]{};
+    uint16_t len_ = 0; // bytes used, excluding the closing ']'
+    uint16_t offsets_[MAX_ITEMS]{};
+    uint16_t lengths_[MAX_ITEMS]{};
+    uint8_t count_ = 0;
+
+    uint8_t frames_[FRAMES_MAX]{};
+    uint16_t framesLen_ = 0;
+    uint16_t frameOffsets_[MAX_ITEMS]{};
+    uint8_t frameLengths_[MAX_ITEMS]{};
+    uint32_t timestamps_[MAX_ITEMS]{};
+    uint32_t chipIds_[MAX_ITEMS]{};
+
+    uint32_t firstMs_ = 0;
+    uint32_t windowMs_ = 0;
+    uint8_t maxItems_ = MAX_ITEMS;
+};
+
+// Brewfather accepts one reading per device every 15 minutes and rejects the
+// rest, so in Brewfather-direct mode we only forward a sensor's reading once
+// its interval has passed. Only accepted POSTs start the interval; after a
+// failed one the sensor's next reading may go out.
+//
+// Usage:
+//   if (limiter.allow(chipId, millis()) && postSucceeded(post(...)))
+//       limiter.record(chipId, millis());
+class UplinkRateLimiter
+{
+public:
+    static constexpr uint8_t MAX_SENSORS = 16;
+    static constexpr uint32_t BREWFATHER_INTERVAL_MS = 15UL * 60UL * 1000UL;
+
+    // True if chipId may be sent now.
+    bool allow(uint32_t chipId, uint32_t nowMs, uint32_t intervalMs = BREWFATHER_INTERVAL_MS) const;
+
+    // Starts chipId's interval; call once Brewfather has taken its reading.
+    void record(uint32_t chipId, uint32_t nowMs);
+
+private:
+    struct Entry
+    {
+        bool used = false;
+        uint32_t chipId = 0;
+        uint32_t lastMs = 0;
+    };
+    Entry entries_[MAX_SENSORS];
+};
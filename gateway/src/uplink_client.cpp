@@ -0,0 +1,130 @@
+#include "uplink_client.h"
+
+#include "tilted_log.h"
+
+// How long to wait on a stalled connection or response.
+static constexpr uint16_t UPLINK_TIMEOUT_MS = 5000;
+
+void UplinkClient::setUrl(const String& url)
+{
+    stop();
+
+    String lower = url;
+    lower.toLowerCase();
+
+    String rest;
+    if (lower.startsWith("http://"))
+    {
+        https_ = false;
+        port_ = 80;
+        url_ = url;
+        rest = url.substring(7);
+    }
+    else if (lower.startsWith("https://"))
+    {
+        https_ = true;
+        port_ = 443;
+        url_ = url;
+        rest = url.substring(8);
+    }
+    else
+    {
+        // No scheme: assume HTTPS
+        https_ = true;
+        port_ = 443;
+        url_ = "https://" + url;
+        rest = url;
+    }
+
+    int slash = rest.indexOf('/');
+    host_ = (slash >= 0) ? rest.substring(0, slash) : rest;
+
+    int colon = host_.indexOf(':');
+    if (colon >= 0)
+    {
+        port_ = (uint16_t)host_.substring(colon + 1).toInt();
+        host_ = host_.substring(0, colon);
+    }
+
+    if (https_)
+        secureClient_.setInsecure(); // skip cert validation if no CA available
+}
+
+WiFiClient& UplinkClient::client()
+{
+    if (https_)
+        return secureClient_;
+    return plainClient_;
+}
+
+UplinkClient::Connection UplinkClient::connect(uint32_t& handshakeMs)
+{
+    handshakeMs = 0;
+    WiFiClient& c = client();
+    if (c.connected())
+        return Connection::Reused;
+
+    const uint32_t start = millis();
+    // Two-argument connect() is the virtual one, so TLS is used for https.
+    if (!c.connect(host_.c_str(), port_))
+    {
+        TILTED_LOGE("Uplink connect to %s:%u failed\n", host_.c_str(), (unsigned)port_);
+        c.stop();
+        return Connection::Failed;
+    }
+    handshakeMs = millis() - start;
+    handshakes_++;
+    return Connection::Opened;
+}
+
+int UplinkClient::post(const char* body, uint16_t len, String* response)
+{
+    if (url_.isEmpty() || host_.isEmpty())
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+
+    uint32_t handshakeMs = 0;
+    const Connection connection = connect(handshakeMs);
+    if (connection == Connection::Failed)
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    const bool reused = (connection == Connection::Reused);
+    if (reused)
+        reusedPosts_++;
+
+    // begin() on an already connected client makes HTTPClient send on it
+    // instead of opening a new connection; setReuse keeps it open after end().
+    http_.setReuse(true);
+    http_.setTimeout(UPLINK_TIMEOUT_MS);
+    if (!http_.begin(client(), url_))
+    {
+        stop();
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    http_.addHeader("Content-Type", "application/json");
+
+    const uint32_t requestStart = millis();
+    const int httpCode = http_.POST(reinterpret_cast<uint8_t*>(const_cast<char*>(body)), len);
+    String resp = http_.getString();
+    [[maybe_unused]] const uint32_t requestMs = millis() - requestStart;
+    http_.end();
+
+    TILTED_LOGD("Uplink POST code=%d %s handshake=%lums request=%lums\n",
+                  httpCode,
+                  reused ? "reused" : "new",
+                  (unsigned long)handshakeMs,
+                  (unsigned long)requestMs);
+
+    // Reconnect lazily on the next post after any transport error.
+    if (httpCode < 0)
+        stop();
+
+    if (response)
+        *response = resp;
+    return httpCode;
+}
+
+void UplinkClient::stop()
+{
+    http_.end();
+    secureClient_.stop();
+    plainClient_.stop();
+}
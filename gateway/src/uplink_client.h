@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+
+// Keep-alive HTTP(S) client for the gateway uplink.
+//
+// The connection (and with it the TLS session) is opened lazily on the first
+// post() and then kept open across posts, so a burst of readings pays for one
+// handshake instead of one per reading. If a request fails the connection is
+// dropped and the next post() reconnects.
+//
+// Reuse only lasts as long as the station stays associated. In the default
+// (non-coexist) gateway mode WiFi is torn down after every drain, and the
+// ESP32 TLS client cannot resume a session on a new socket, so there every
+// drain pays for a full handshake; the savings need wifiCoexist.
+//
+// Usage:
+//   UplinkClient uplink;
+//   uplink.setUrl(brewfatherURL);
+//   int code = uplink.post(body, len);
+//   ...
+//   uplink.stop(); // before tearing down WiFi
+class UplinkClient
+{
+public:
+    // Accepts http:// and https:// URLs; no scheme means https.
+    void setUrl(const String& url);
+
+    // POSTs a JSON body. Returns the HTTP status code, or a negative
+    // HTTPClient error. If response is non-null it receives the body.
+    int post(const char* body, uint16_t len, String* response = nullptr);
+
+    // Closes the connection; the next post() reconnects.
+    void stop();
+
+    uint32_t handshakes() const { return handshakes_; }
+    uint32_t reusedPosts() const { return reusedPosts_; }
+
+private:
+    enum class Connection
+    {
+        Failed,
+        Reused, // already open, no handshake
+        Opened, // new connection (and TLS handshake)
+    };
+
+    // handshakeMs is only set for Opened.
+    Connection connect(uint32_t& handshakeMs);
+    WiFiClient& client();
+
+    WiFiClientSecure secureClient_;
+    WiFiClient plainClient_;
+    HTTPClient http_;
+
+    String url_;
+    String host_;
+    uint16_t port_ = 443;
+    bool https_ = true;
+
+    uint32_t handshakes_ = 0;
+    uint32_t reusedPosts_ = 0;
+};
@@ -0,0 +1,226 @@
+#include "uplink_spool.h"
+
+#include <LittleFS.h>
+
+#include "tilted_log.h"
+
+static constexpr const char* SPOOL_PATH = "/spool.bin";
+static constexpr const char* SPOOL_TAIL_PATH = "/spool.tail";
+// Bumped whenever the record layout changes, so begin() ignores old records.
+static constexpr uint16_t SPOOL_MAGIC = 0x5054;
+
+// Keep a handful of slots even for tiny retention settings.
+static constexpr uint32_t SPOOL_MIN_RECORDS = 4;
+
+static uint8_t crc8(uint8_t crc, const uint8_t* data, size_t len)
+{
+    // CRC-8/SMBUS (poly 0x07).
+    while (len--)
+    {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+uint8_t UplinkSpool::recordCrc(const Record& r)
+{
+    uint8_t crc = crc8(0, reinterpret_cast<const uint8_t*>(&r.seq), sizeof(r.seq));
+    crc = crc8(crc, reinterpret_cast<const uint8_t*>(&r.epoch), sizeof(r.epoch));
+    return crc8(crc, r.frame, r.len);
+}
+
+bool UplinkSpool::begin(uint32_t retentionBytes)
+{
+    capacity_ = 0;
+    staged_ = 0;
+
+    if (!LittleFS.begin(true))
+    {
+        TILTED_LOGE("Spool: LittleFS mount failed; undeliverable readings will be dropped\n");
+        return false;
+    }
+
+    const uint32_t records = max(retentionBytes / RECORD_BYTES, SPOOL_MIN_RECORDS);
+
+    File f = LittleFS.open(SPOOL_PATH, "r");
+    const bool sized = f && f.size() == records * RECORD_BYTES;
+    if (f)
+        f.close();
+
+    capacity_ = records;
+    if (!sized && !createFile())
+    {
+        capacity_ = 0;
+        return false;
+    }
+
+    recover();
+    TILTED_LOGI("Spool: %lu records, %lu pending\n", (unsigned long)capacity_, (unsigned long)pending());
+    return true;
+}
+
+// Preallocates the ring so records are always rewritten in place.
+bool UplinkSpool::createFile()
+{
+    LittleFS.remove(SPOOL_TAIL_PATH);
+    File f = LittleFS.open(SPOOL_PATH, "w");
+    if (!f)
+    {
+        TILTED_LOGE("Spool: cannot create spool file\n");
+        return false;
+    }
+
+    static const uint8_t zeros[RECORD_BYTES] = {};
+    for (uint32_t i = 0; i < capacity_; i++)
+    {
+        if (f.write(zeros, sizeof(zeros)) != sizeof(zeros))
+        {
+            TILTED_LOGE("Spool: not enough flash for the configured retention\n");
+            f.close();
+            LittleFS.remove(SPOOL_PATH);
+            return false;
+        }
+    }
+    f.close();
+    return true;
+}
+
+void UplinkSpool::recover()
+{
+    head_ = 0;
+    tail_ = 0;
+
+    File f = LittleFS.open(SPOOL_PATH, "r");
+    if (!f)
+        return;
+
+    bool any = false;
+    uint32_t newest = 0;
+    Record r;
+    for (uint32_t slot = 0; slot < capacity_; slot++)
+    {
+        if (f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) != sizeof(r))
+            break;
+        if (r.magic != SPOOL_MAGIC || r.len > FRAME_MAX || r.seq % capacity_ != slot || r.crc != recordCrc(r))
+            continue;
+        if (!any || r.seq > newest)
+            newest = r.seq;
+        any = true;
+    }
+    f.close();
+
+    if (!any)
+        return;
+    head_ = newest + 1;
+
+    File t = LittleFS.open(SPOOL_TAIL_PATH, "r");
+    if (t)
+    {
+        uint32_t saved = 0;
+        if (t.read(reinterpret_cast<uint8_t*>(&saved), sizeof(saved)) == sizeof(saved))
+            tail_ = saved;
+        t.close();
+    }
+
+    if (tail_ > head_)
+        tail_ = head_;
+    if (head_ - tail_ > capacity_)
+        tail_ = head_ - capacity_;
+}
+
+bool UplinkSpool::append(const uint8_t* frame, uint8_t len, uint32_t epoch)
+{
+    if (!ready() || !frame || len == 0 || len > FRAME_MAX || (staged_ == STAGE_RECORDS && !flush()))
+    {
+        dropped_++;
+        return false;
+    }
+
+    Record& r = stage_[staged_];
+    memset(&r, 0, sizeof(r));
+    r.magic = SPOOL_MAGIC;
+    r.len = len;
+    r.seq = head_ + staged_;
+    r.epoch = epoch;
+    memcpy(r.frame, frame, len);
+    r.crc = recordCrc(r);
+    staged_++;
+    return true;
+}
+
+bool UplinkSpool::flush()
+{
+    if (staged_ == 0)
+        return true;
+    if (!ready())
+        return false;
+
+    File f = LittleFS.open(SPOOL_PATH, "r+");
+    if (!f)
+    {
+        TILTED_LOGE("Spool: cannot open spool file\n");
+        return false;
+    }
+
+    uint8_t written = 0;
+    for (; written < staged_; written++)
+    {
+        const Record& r = stage_[written];
+        if (!f.seek((r.seq % capacity_) * RECORD_BYTES) ||
+            f.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r)) != sizeof(r))
+            break;
+    }
+    f.close();
+
+    head_ += written;
+    if (head_ - tail_ > capacity_)
+    {
+        overwritten_ += head_ - tail_ - capacity_;
+        tail_ = head_ - capacity_;
+    }
+
+    const bool ok = (written == staged_);
+    if (!ok)
+        TILTED_LOGE("Spool: write failed, %u reading(s) dropped\n", (unsigned)(staged_ - written));
+    staged_ = 0;
+    return ok;
+}
+
+bool UplinkSpool::read(uint32_t seq, uint8_t* frame, uint8_t& len, uint32_t& epoch)
+{
+    if (!ready() || seq < tail_ || seq >= head_)
+        return false;
+
+    File f = LittleFS.open(SPOOL_PATH, "r");
+    if (!f)
+        return false;
+
+    Record r;
+    const bool got = f.seek((seq % capacity_) * RECORD_BYTES) &&
+                     f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) == sizeof(r);
+    f.close();
+
+    if (!got || r.magic != SPOOL_MAGIC || r.seq != seq || r.len > FRAME_MAX || r.crc != recordCrc(r))
+        return false;
+
+    memcpy(frame, r.frame, r.len);
+    len = r.len;
+    epoch = r.epoch;
+    return true;
+}
+
+void UplinkSpool::consume(uint32_t seq)
+{
+    if (!ready() || seq <= tail_)
+        return;
+    tail_ = (seq > head_) ? head_ : seq;
+
+    File t = LittleFS.open(SPOOL_TAIL_PATH, "w");
+    if (t)
+    {
+        t.write(reinterpret_cast<const uint8_t*>(&tail_), sizeof(tail_));
+        t.close();
+    }
+}
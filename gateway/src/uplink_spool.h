@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "tilted_protocol.h"
+
+// Store-and-forward ring for readings that could not be delivered.
+//
+// Raw TLV frames (not JSON) are kept in fixed-size records in one
+// preallocated LittleFS file, used as a ring: record seq lives in slot
+// seq % capacity(), so a full spool overwrites its oldest readings instead
+// of refusing new ones. LittleFS spreads the block erases around the
+// partition.
+//
+// To bound write amplification, append() only stages records in RAM; flush()
+// writes them with a single open/close, and the delivered position is
+// persisted once per consume() rather than once per record. After a reboot
+// begin() recovers the newest record by scanning the record headers.
+//
+// Usage:
+//   UplinkSpool spool;
+//   spool.begin(64 * 1024);
+//   spool.append(frame, len, time(nullptr)); // uplink failed
+//   spool.flush();
+//   for (uint32_t seq = spool.tail(); seq != spool.head(); seq++)
+//       if (spool.read(seq, frame, len, epoch)) ... // replay
+//   spool.consume(seq);                              // once delivered
+class UplinkSpool
+{
+public:
+    // Room for any ESP-NOW frame, plus the 12-byte record header.
+    static constexpr uint16_t FRAME_MAX = TILTED_MAX_FRAME_LEN;
+    static constexpr uint16_t RECORD_BYTES = 12 + FRAME_MAX;
+
+    // Mounts LittleFS (formatting it if needed) and opens or creates a spool
+    // holding retentionBytes worth of records. Changing the size drops
+    // whatever was spooled before. Returns false if flash is unavailable.
+    bool begin(uint32_t retentionBytes);
+
+    bool ready() const { return capacity_ != 0; }
+
+    // Stages one frame, taken at unix time epoch (0 if unknown). Staged
+    // records are written by flush(), or when the stage fills up. Returns
+    // false, and counts the frame in dropped(), if it cannot be kept.
+    bool append(const uint8_t* frame, uint8_t len, uint32_t epoch);
+    bool flush();
+
+    // Sequence numbers of the oldest undelivered record and one past the
+    // newest written record.
+    uint32_t tail() const { return tail_; }
+    uint32_t head() const { return head_; }
+    uint32_t pending() const { return head_ - tail_; }
+    uint32_t capacity() const { return capacity_; }
+
+    // Reads record seq into frame (FRAME_MAX bytes). Returns false if it is
+    // corrupt or has been overwritten; the caller should skip it.
+    bool read(uint32_t seq, uint8_t* frame, uint8_t& len, uint32_t& epoch);
+
+    // Marks every record before seq as delivered.
+    void consume(uint32_t seq);
+
+    // Records lost because the spool wrapped before they were replayed.
+    uint32_t overwritten() const { return overwritten_; }
+
+    // Frames append() refused (too long, spool unavailable or unwritable).
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    struct __attribute__((packed)) Record
+    {
+        uint16_t magic;
+        uint8_t len;
+        uint8_t crc; // CRC-8 over seq, epoch and frame
+        uint32_t seq;
+        uint32_t epoch;
+        uint8_t frame[FRAME_MAX];
+    };
+    static_assert(sizeof(Record) == RECORD_BYTES, "spool record must be RECORD_BYTES");
+
+    // Staged records are written together, so keep this at least one batch.
+    static constexpr uint8_t STAGE_RECORDS = 8;
+
+    static uint8_t recordCrc(const Record& r);
+    bool createFile();
+    void recover();
+
+    Record stage_[STAGE_RECORDS];
+    uint8_t staged_ = 0;
+
+    uint32_t capacity_ = 0; // records
+    uint32_t head_ = 0;
+    uint32_t tail_ = 0;
+    uint32_t overwritten_ = 0;
+    uint32_t dropped_ = 0;
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <time.h>
+
+// time() is below this until SNTP has synced; readings are stamped on
+// arrival (timestamp 0) rather than with a bogus 1970 date until then.
+inline constexpr time_t EPOCH_VALID_AFTER = 1600000000;
@@ -2,6 +2,9 @@
 
 #include "bmp280_sampler.h"
 
+#include "tilted_log.h"
+#include "tilted_value_helper.h"
+
 Bmp280Sampler::Bmp280Sampler(uint8_t i2cAddr) : addr_(i2cAddr) {}
 
 void Bmp280Sampler::begin(TwoWire& wire)
@@ -17,12 +20,12 @@ void Bmp280Sampler::begin(TwoWire& wire)
     // not present at `addr_`.
     Adafruit_BMP280* bmp = new Adafruit_BMP280();
     if (bmp->begin(addr_)) {
-        Serial.println("BMP280 init succeeded");
+        TILTED_LOGD("BMP280 init succeeded\n");
         sensor_ = bmp;
     } else {
         delete bmp;
         sensor_ = nullptr;
-        Serial.println("BMP280 init failed");
+        TILTED_LOGE("BMP280 init failed\n");
     }
     state_ = State::Idle;
 }
@@ -50,6 +53,14 @@ bool Bmp280Sampler::sample()
     return true;
 }
 
+uint8_t Bmp280Sampler::emitItems(TiltedValueItem* out) const
+{
+    if (!isfinite(tempC_))
+        return 0;
+    out[0] = TiltedValueHelper::auxTempC(tempC_);
+    return 1;
+}
+
 void Bmp280Sampler::sleep()
 {
     // BMP has no standard sleep API in Adafruit library. Free the object.
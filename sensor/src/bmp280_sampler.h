@@ -7,6 +7,8 @@
 #include <Wire.h>
 #include <Adafruit_BMP280.h>
 
+#include "tilted_protocol.h"
+
 // BMP280-only sampler: we only use BMP280 for auxiliary temperature here.
 // We intentionally do NOT expose pressure to avoid confusing environmental
 // pressure with keg/fermentor gauge pressure.
@@ -30,12 +32,18 @@ public:
     bool sample();
 
     bool pending() const { return state_ == State::Reading; }
+    // Reads are immediate.
+    uint32_t msUntilReady() const { return 0; }
     bool ready() const { return state_ == State::Ready; }
 
     float temperatureC() const { return tempC_; }
 
     void sleep();
 
+    // SamplerSet interface (see sampler_set.h): one aux temperature, if read.
+    static constexpr uint8_t ITEM_COUNT = 1;
+    uint8_t emitItems(TiltedValueItem* out) const;
+
 private:
     enum class State : uint8_t {
         Idle,
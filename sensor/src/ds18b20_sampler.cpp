@@ -1,5 +1,7 @@
 #include "ds18b20_sampler.h"
 
+#include "tilted_value_helper.h"
+
 #if TILTED_ENABLE_DS18B20
 
 Ds18b20Sampler::Ds18b20Sampler(OneWire& oneWire) : oneWire_(oneWire), sensor_(&oneWire) {}
@@ -72,4 +74,20 @@ bool Ds18b20Sampler::sample()
 	return true;
 }
 
+uint32_t Ds18b20Sampler::msUntilReady() const
+{
+	if (state_ != State::Converting)
+		return 0;
+	const uint32_t elapsed = millis() - startMs_;
+	return (elapsed < conversionMs_) ? conversionMs_ - elapsed : 0;
+}
+
+uint8_t Ds18b20Sampler::emitItems(TiltedValueItem* out) const
+{
+	if (!isfinite(tempC_))
+		return 0;
+	out[0] = TiltedValueHelper::auxTempC(tempC_);
+	return 1;
+}
+
 #endif // TILTED_ENABLE_DS18B20
@@ -6,6 +6,8 @@
 #include <OneWire.h>
 #include <DallasTemperature.h>
 
+#include "tilted_protocol.h"
+
 // Simple non-blocking DS18B20 sampler.
 // - Call begin() once.
 // - Call start() when you want a new reading.
@@ -24,10 +26,18 @@ public:
 	bool sample();
 
 	bool pending() const { return state_ == State::Converting; }
+	// While converting: ms until the result can be read.
+	uint32_t msUntilReady() const;
 	bool ready() const { return state_ == State::Ready; }
 
 	float temperatureC() const { return tempC_; }
 
+	// SamplerSet interface (see sampler_set.h): one aux temperature, if read.
+	static constexpr uint8_t ITEM_COUNT = 1;
+	uint8_t emitItems(TiltedValueItem* out) const;
+	// The DS18B20 idles on its own once a conversion is done.
+	void sleep() {}
+
 private:
 	enum class State : uint8_t {
 		Idle,
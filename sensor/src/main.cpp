@@ -14,6 +14,8 @@
 #endif
 
 #include "mpu_sampler.h"
+#include "rtc_state.h"
+#include "sampler_set.h"
 
 #if TILTED_ENABLE_DS18B20
 #include "ds18b20_sampler.h"
@@ -22,6 +24,8 @@
 #include "bmp280_sampler.h"
 #endif
 
+#include "tilted_compact.h"
+#include "tilted_log.h"
 #include "tilted_protocol.h"
 #include "tilted_sensor_id.h"
 #include "tilted_packet_builder.h"
@@ -43,9 +47,36 @@ ADC_MODE(ADC_VCC);
 // Optional: only used when TILTED_ENABLE_DS18B20=1
 #define ONE_WIRE_PIN 14 // GPIO14 / D5
 
+// MPU INT pin. When wired (e.g. -DTILTED_MPU_INT_PIN=12), samples are taken as
+// soon as the MPU flags them instead of polling its status over I2C.
+// -1 keeps the polling mode.
+#ifndef TILTED_MPU_INT_PIN
+#define TILTED_MPU_INT_PIN -1
+#endif
+
+// Let the MPU buffer the whole sample window in its FIFO and read it in one
+// burst (-DTILTED_MPU_FIFO=1). Takes precedence over TILTED_MPU_INT_PIN.
+#ifndef TILTED_MPU_FIFO
+#define TILTED_MPU_FIFO 0
+#endif
+
 // number of tilt samples to average
 #define MAX_SAMPLES 7
-#define SAMPLE_DELAY_MS 20
+// Convergence: stop sampling once this many samples agree within
+// TILT_CONVERGE_SPREAD_DEG; MAX_SAMPLES is the upper bound. 0 always takes
+// MAX_SAMPLES. The spread is below the 0.1 degree the angle is sent with.
+#ifndef TILT_CONVERGE_MIN_SAMPLES
+#define TILT_CONVERGE_MIN_SAMPLES 3
+#endif
+#ifndef TILT_CONVERGE_SPREAD_DEG
+#define TILT_CONVERGE_SPREAD_DEG 0.05f
+#endif
+
+// Outlier rejection for the tilt window: average the samples within this many
+// scaled MADs of the median. 0 reports the plain median.
+#ifndef TILT_OUTLIER_MAD_K
+#define TILT_OUTLIER_MAD_K 0.0f
+#endif
 
 // Normal interval should be long enough to stretch out battery life. Since
 // we're using the MPU temp sensor, we're probably going to see slower
@@ -53,23 +84,138 @@ ADC_MODE(ADC_VCC);
 #define NORMAL_INTERVAL 980
 
 // In calibration mode, we need more frequent updates.
-// Here we define the RTC address to use and the number of iterations.
+// Here we define the number of iterations (counted in RtcState).
 // 60 iterations with an interval of 30 equals 30 minutes.
 #define CALIBRATION_INTERVAL 30
-#define RTC_ADDRESS 0
 #define CALIBRATION_ITERATIONS 60
 #define CALIBRATION_TILT_ANGLE_MIN 170
 #define CALIBRATION_TILT_ANGLE_MAX 180
 #define CALIBRATION_SETUP_TIME 30000
 #define WIFI_TIMEOUT 10000
 
+// A gateway that keeps its WiFi connected listens on its router's channel
+// rather than TILTED_ESPNOW_CHANNEL. We remember the last channel the gateway
+// ACKed on in RtcState and sweep all channels when it stops ACKing.
+#define ESPNOW_MAX_CHANNEL 13
+#define ESPNOW_ACK_TIMEOUT_MS 30
+// Fast resends on the known channel before falling back to the sweep.
+#define ESPNOW_SEND_RETRIES 2
+#define ESPNOW_RETRY_BACKOFF_MS 3
+
+// We wake with WAKE_NO_RFCAL and reuse the stored RF calibration. Redo the
+// full calibration this often (48 * 980 s is about 13 h), or after a wake
+// that had to sweep channels, to follow temperature drift.
+#define RF_CAL_EVERY_N_WAKES 48
+
+// The radio is the biggest energy cost of a cycle. With N > 1 each wake still
+// samples, but readings are held in RTC memory and go out N at a time in one
+// batch frame, each with its own age. 1 sends on every wake. Calibration
+// mode always sends. Readings that miss the gateway are kept for the next
+// batch (up to RTC_MAX_BUFFERED).
+#ifndef TRANSMIT_EVERY_N_WAKES
+#define TRANSMIT_EVERY_N_WAKES 1
+#endif
+static_assert(TRANSMIT_EVERY_N_WAKES >= 1 && TRANSMIT_EVERY_N_WAKES <= RTC_MAX_BUFFERED + 1,
+              "TRANSMIT_EVERY_N_WAKES must fit the RTC reading buffer");
+
+// Adaptive interval (-DTILTED_ADAPTIVE_INTERVAL=1). The tilt barely moves for
+// days in the lag and conditioning phases. While the slope over the last
+// RTC_TILT_HISTORY readings stays under TILT_FLAT_DEG_PER_H, each wake sleeps
+// half as long again as the last, up to TILTED_MAX_INTERVAL. Once it is over
+// TILT_ACTIVE_DEG_PER_H, the interval drops back to NORMAL_INTERVAL.
+// Calibration mode is unaffected. Frames carry the interval in use, so the
+// gateway knows when to expect the next one.
+#ifndef TILTED_ADAPTIVE_INTERVAL
+#define TILTED_ADAPTIVE_INTERVAL 0
+#endif
+#ifndef TILTED_MAX_INTERVAL
+#define TILTED_MAX_INTERVAL 3600
+#endif
+#define TILT_FLAT_DEG_PER_H 0.2f
+#define TILT_ACTIVE_DEG_PER_H 0.5f
+// deepSleepInstant() takes 64-bit microseconds but the ESP8266 tops out at
+// about 3.5 h (ESP.deepSleepMax()).
+static_assert(TILTED_MAX_INTERVAL >= NORMAL_INTERVAL && TILTED_MAX_INTERVAL <= 10800,
+              "TILTED_MAX_INTERVAL must lie between NORMAL_INTERVAL and 3 h");
+
+// Skip unchanged readings (-DTILTED_SKIP_UNCHANGED=1): a wake whose tilt and
+// temperature are within the deadbands of the last reading the gateway ACKed
+// leaves the radio off. Every TILTED_HEARTBEAT_EVERY_N_WAKES wakes a frame
+// goes out anyway. Frames carry the resulting longest silence (HeartbeatS),
+// so the gateway can tell a quiet sensor from a lost one. Skipped readings are
+// not numbered and do not count as lost.
+#ifndef TILTED_SKIP_UNCHANGED
+#define TILTED_SKIP_UNCHANGED 0
+#endif
+#ifndef TILTED_HEARTBEAT_EVERY_N_WAKES
+#define TILTED_HEARTBEAT_EVERY_N_WAKES 6
+#endif
+#define TILT_DEADBAND_DEG 0.1f
+#define TEMP_DEADBAND_C 0.2f
+static_assert(TILTED_HEARTBEAT_EVERY_N_WAKES >= 1 && TILTED_HEARTBEAT_EVERY_N_WAKES <= 255,
+              "TILTED_HEARTBEAT_EVERY_N_WAKES must fit RtcState::quietWakes");
+
+// Send compact (v2) frames: varint items with implied scales, about half the
+// airtime of the fixed TLV format. Needs a gateway that knows the format. The
+// name goes out on the first frame after power-on and then every
+// TILTED_NAME_EVERY_N_FRAMES frames, so a rebooted gateway relearns it.
+#ifndef TILTED_COMPACT_FRAMES
+#define TILTED_COMPACT_FRAMES 0
+#endif
+#define TILTED_NAME_EVERY_N_FRAMES 64
+
+// Start radio bring-up at the start of the sample window rather than once
+// sampling is done. Shorter wakes, at the cost of the radio drawing current
+// while the sensors settle; -DTILTED_EARLY_RADIO=0 restores the old order.
+#ifndef TILTED_EARLY_RADIO
+#define TILTED_EARLY_RADIO 1
+#endif
+
+// Settings downlink (-DTILTED_DOWNLINK=1): the first frame after power-on and
+// then every TILTED_CONFIG_POLL_EVERY_N_FRAMES frames carry a ConfigVersion
+// item, and the sensor listens up to CONFIG_LISTEN_MS after the ACK for the
+// gateway's config frame (interval, sample count, deadbands). Other wakes do
+// not listen and are no longer than before. A gateway with nothing new
+// does not reply, so a poll costs the full listen window.
+#ifndef TILTED_DOWNLINK
+#define TILTED_DOWNLINK 0
+#endif
+#ifndef TILTED_CONFIG_POLL_EVERY_N_FRAMES
+#define TILTED_CONFIG_POLL_EVERY_N_FRAMES 12
+#endif
+#define CONFIG_LISTEN_MS 30
+static_assert(TILTED_CONFIG_POLL_EVERY_N_FRAMES >= 1 && TILTED_CONFIG_POLL_EVERY_N_FRAMES <= 255,
+              "TILTED_CONFIG_POLL_EVERY_N_FRAMES must fit RtcState::framesSinceConfigPoll");
+
 // Version identifier (kept for build info).
 const char versionTimestamp[] = "TiltedSensor " __DATE__ " " __TIME__;
 
 // when we booted
 static unsigned long bootTime, wifiTime, sent, calibrationSetupStart, calibrationWifiStart = 0;
-
-uint32_t calibrationIterations = 0;
+// start and end of this cycle's sample window, for the awake-time report
+static unsigned long samplingStart, samplingDone = 0;
+
+// Calibration counter, ESP-NOW channel and radio bring-up cache; saved once
+// per cycle in actuallySleep().
+static RtcState rtcState;
+// Set when this wake had to sweep channels; forces an RF calibration.
+static bool radioTrouble = false;
+// This wake's rst_info::reason, sent as telemetry.
+static uint8_t resetReason = 0;
+
+// Radio bring-up, split so it can run alongside sampling: radioWake() powers
+// the radio up, radioPoll() makes one esp_now_init() attempt when one is due,
+// and radioBringUp() finishes the job (blocking) if sampling ends first.
+enum RadioPhase : uint8_t {
+    RADIO_OFF,
+    RADIO_STARTING,
+    RADIO_READY,
+    RADIO_FAILED
+};
+static RadioPhase radioPhase = RADIO_OFF;
+static unsigned long radioStart = 0;
+static unsigned long radioNextTry = 0;
+static uint8_t radioAttempts = 0;
 
 // Sensor state variables
 enum SensorState {
@@ -88,19 +234,32 @@ RF_PRE_INIT()
 }
 
 //------------------------------------------------------------
-static long sleep_interval = NORMAL_INTERVAL;
+static uint32_t sleep_interval = NORMAL_INTERVAL; // seconds
 
 static MpuSampler mpuSampler(MAX_SAMPLES);
 
 #if TILTED_ENABLE_DS18B20
 static OneWire oneWire(ONE_WIRE_PIN);
 static Ds18b20Sampler ds18b20Sampler(oneWire);
+#else
+static NoSampler ds18b20Sampler;
 #endif
 
 #if defined(TILTED_ENABLE_BMP280)
 static Bmp280Sampler bmp280Sampler;
+#else
+static NoSampler bmp280Sampler;
 #endif
 
+// Everything read on each wake, in TLV item order. A new sensor only needs
+// the SamplerSet interface and an entry here.
+static SamplerSet<MpuSampler, decltype(ds18b20Sampler), decltype(bmp280Sampler)>
+	samplers(mpuSampler, ds18b20Sampler, bmp280Sampler);
+
+// Sampler items plus battery, interval, three telemetry items, heartbeat,
+// config version, sequence and tx retries.
+static constexpr uint8_t TILTED_ITEM_CAPACITY = decltype(samplers)::ITEM_COUNT + 9;
+
 //------------------------------------------------------------
 static const int led = LED_BUILTIN;
 
@@ -114,27 +273,52 @@ static inline void ledOff()
 }
 
 
-static void actuallySleep()
+// radioOff = false skips the orderly WiFi shutdown; deep sleep powers the
+// radio down anyway, so after an ACK there is no point waiting for it.
+static void actuallySleep(bool radioOff = true)
 {
-    // Put MPU to sleep if not already done
-    mpuSampler.sleep();
-    Serial.println("MPU put to sleep");
-    // Put BMP280 to sleep if present
-#if defined(TILTED_ENABLE_BMP280)
-    bmp280Sampler.sleep();
-#endif
+    // Put the sensors to sleep if not already done
+    samplers.sleep();
+    TILTED_LOGD("Sensors put to sleep\n");
     
-    // Turn off WiFi completely to save power
-    WiFi.mode(WIFI_OFF);
-    WiFi.forceSleepBegin();
-    delay(1); // Give WiFi time to shut down
-
-    double uptime = (millis() - bootTime) / 1000.;
+    if (radioOff) {
+        // Turn off WiFi completely to save power
+        WiFi.mode(WIFI_OFF);
+        WiFi.forceSleepBegin();
+        delay(1); // Give WiFi time to shut down
+    }
 
-    Serial.printf("bootTime: %ld WifiTime: %ld\n", bootTime, wifiTime);
-    Serial.printf("Deep sleeping %ld seconds after %.3g awake\n", sleep_interval, uptime);
+    const unsigned long now = millis();
+    [[maybe_unused]] double uptime = (now - bootTime) / 1000.;
+
+    // Sent as telemetry with the next frame.
+    rtcState.lastAwakeMs = (uint16_t)min(now - bootTime, 0xFFFFUL);
+    if (!sent)
+        rtcState.lastRadioMs = (radioPhase == RADIO_OFF) ? 0 : (uint16_t)min(now - radioStart, 0xFFFFUL);
+
+    TILTED_LOGD("bootTime: %ld WifiTime: %ld\n", bootTime, wifiTime);
+    TILTED_LOGI("Awake %lu ms: setup %lu ms, sampling %lu ms, radio %lu ms\n",
+                  now - bootTime,
+                  samplingStart - bootTime,
+                  samplingDone ? samplingDone - samplingStart : now - samplingStart,
+                  (unsigned long)rtcState.lastRadioMs);
+    // Per-phase timestamps, ms since boot; 0 = phase not reached.
+    TILTED_LOGI("Timeline: boot %lu, sample done %lu, radio ready %lu, sent %lu\n",
+                  bootTime, samplingDone, wifiTime, sent);
+    TILTED_LOGI("Deep sleeping %lu seconds after %.3g awake\n", (unsigned long)sleep_interval, uptime);
+
+    RFMode wakeMode = WAKE_NO_RFCAL;
+    if (radioTrouble || ++rtcState.wakesSinceRfCal >= RF_CAL_EVERY_N_WAKES) {
+        wakeMode = WAKE_RFCAL;
+        rtcState.wakesSinceRfCal = 0;
+    }
+    rtcState.clockS += sleep_interval + (uint32_t)((now - bootTime + 500) / 1000);
+    rtcStateSave(rtcState);
 
-    ESP.deepSleepInstant(sleep_interval * 1000000, WAKE_NO_RFCAL);
+    // The only place the sensor waits on the UART.
+    tilted_log_flush();
+    // In 64 bits: anything over 2147 s overflows 32-bit microseconds.
+    ESP.deepSleepInstant((uint64_t)sleep_interval * 1000000ULL, wakeMode);
 }
 
 //-----------------------------------------------------------------
@@ -156,151 +340,523 @@ static inline int readVoltage()
 // on a full power-on (not deep-sleep wake) to help with diagnostics.
 static void doI2CScan(TwoWire& wire)
 {
-    Serial.println("I2C scan starting");
+    TILTED_LOGI("I2C scan starting\n");
     for (uint8_t addr = 1; addr < 127; addr++) {
         wire.beginTransmission(addr);
         uint8_t err = wire.endTransmission();
         if (err == 0) {
-            Serial.print("Found I2C device at 0x");
-            if (addr < 16) Serial.print('0');
-            Serial.println(addr, HEX);
+            TILTED_LOGI("Found I2C device at 0x%02X\n", (unsigned)addr);
         }
         delay(1);
     }
-    Serial.println("Scan complete");
+    TILTED_LOGI("Scan complete\n");
 }
 
-// TLV item capacity depends on optional sensors.
-// Base fields: tilt, temp, battery, interval
-#if TILTED_ENABLE_DS18B20
-    #if defined(TILTED_ENABLE_BMP280)
-        static constexpr uint8_t TILTED_ITEM_CAPACITY = 6; // DS18B20 + BMP (two aux temps)
-    #else
-        static constexpr uint8_t TILTED_ITEM_CAPACITY = 5; // DS18B20 only
-    #endif
-#else
-    #if defined(TILTED_ENABLE_BMP280)
-        static constexpr uint8_t TILTED_ITEM_CAPACITY = 5; // BMP aux temp
-    #else
-        static constexpr uint8_t TILTED_ITEM_CAPACITY = 4; // base
-    #endif
-#endif
+static volatile bool sendDone = false;
+static volatile bool sendAcked = false;
+static unsigned long sendStartUs = 0;
+static volatile unsigned long sendDoneUs = 0;
+
+static void onEspNowSent(uint8_t* mac, uint8_t status)
+{
+    (void)mac;
+    sendDoneUs = micros();
+    sendAcked = (status == 0);
+    sendDone = true;
+}
+
+// The gateway's config frame, copied here by the receive callback and
+// applied after the send (see TILTED_DOWNLINK).
+static uint8_t configFrame[sizeof(TiltedConfigHeader) + TILTED_MAX_CONFIG_ITEMS * sizeof(TiltedValueItem)];
+static volatile uint8_t configFrameLen = 0;
+
+static void onEspNowRecv(uint8_t* mac, uint8_t* data, uint8_t len)
+{
+    (void)mac;
+    uint16_t magic = 0;
+    if (configFrameLen != 0 || len < sizeof(magic) || len > sizeof(configFrame))
+        return;
+    memcpy(&magic, data, sizeof(magic));
+    if (magic != TILTED_CONFIG_MAGIC)
+        return;
+    memcpy(configFrame, data, len);
+    configFrameLen = len;
+}
+
+// Sends one frame to the gateway on the given channel and waits briefly for the MAC-layer ACK.
+static bool sendOnChannel(uint8_t channel, uint8_t* buf, uint16_t len)
+{
+    wifi_set_channel(channel);
+    esp_now_set_peer_channel((uint8_t*)TILTED_GATEWAY_MAC, channel);
+
+    sendDone = false;
+    sendAcked = false;
+    sendStartUs = micros();
+    if (esp_now_send((uint8_t*)TILTED_GATEWAY_MAC, buf, len) != 0)
+        return false;
+
+    unsigned long start = millis();
+    while (!sendDone && (millis() - start) < ESPNOW_ACK_TIMEOUT_MS) {
+        delay(1);
+    }
+    if (sendDone)
+        TILTED_LOGD("ch %u: %s after %lu us\n", (unsigned)channel, sendAcked ? "ACK" : "NACK", sendDoneUs - sendStartUs);
+    return sendAcked;
+}
+
+static void radioWake()
+{
+    if (radioPhase != RADIO_OFF)
+        return;
+    radioStart = millis();
+
+    WiFi.forceSleepWake();
+    delay(1);
+    WiFi.mode(WIFI_STA);
+    if (!(rtcState.radioFlags & RTC_RADIO_AUTOCONNECT_OFF)) {
+        // First wake after power-on: make sure the SDK never starts associating
+        // on its own. Persisted in flash, so later wakes skip this.
+        WiFi.disconnect();
+        WiFi.setAutoConnect(false);
+        rtcState.radioFlags |= RTC_RADIO_AUTOCONNECT_OFF;
+    }
+
+    radioAttempts = 0;
+    radioNextTry = millis();
+    radioPhase = RADIO_STARTING;
+}
+
+// Records the bring-up cost in rtcState once it has succeeded or given up.
+static void radioSettled(bool up)
+{
+    wifiTime = millis();
+    const unsigned long cost = wifiTime - radioStart;
+    TILTED_LOGD("Radio %s in %lu ms, %u init attempt(s) (last wake %u ms, %u)\n",
+                  up ? "up" : "failed", cost, (unsigned)radioAttempts,
+                  (unsigned)rtcState.lastInitMs, (unsigned)rtcState.lastInitAttempts);
+    rtcState.lastInitMs = (uint16_t)min(cost, 0xFFFFUL);
+    rtcState.lastInitAttempts = up ? radioAttempts : 0;
+    radioPhase = up ? RADIO_READY : RADIO_FAILED;
+}
+
+// Makes progress on a started bring-up without blocking.
+static void radioPoll()
+{
+    if (radioPhase != RADIO_STARTING || (long)(millis() - radioNextTry) < 0)
+        return;
+
+    radioAttempts++;
+    if (esp_now_init() == 0)
+        radioSettled(true);
+    else if ((millis() - radioStart) >= WAKE_TIMEOUT / 2)  // Shorter timeout for ESP-NOW
+        radioSettled(false);
+    else
+        radioNextTry = millis() + 10;
+}
+
+// Time until radioPoll() next has work; 0 if it has none.
+static uint32_t radioMsUntilReady()
+{
+    if (radioPhase != RADIO_STARTING)
+        return 0;
+    const long left = (long)(radioNextTry - millis());
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+// Wakes the radio if needed and waits for ESP-NOW, recording the cost in
+// rtcState. Returns false if ESP-NOW would not start.
+static bool radioBringUp()
+{
+    radioWake();
+    while (radioPhase == RADIO_STARTING) {
+        radioPoll();
+        if (radioPhase == RADIO_STARTING)
+            delay(radioMsUntilReady());
+    }
+    return radioPhase == RADIO_READY;
+}
+
+static void saveEspNowChannel(uint8_t channel)
+{
+    rtcState.espnowChannel = channel;
+}
+
+static int16_t toTenths(float v)
+{
+    return isfinite(v) ? (int16_t)lroundf(v * 10.0f) : RTC_NO_AUX_TEMP;
+}
+
+// This wake's reading in its RTC form.
+static RtcReading captureReading()
+{
+    RtcReading r{};
+    r.takenAtS = rtcState.clockS;
+    r.seq = rtcState.sequence;
+    r.tilt10 = toTenths(mpuSampler.filteredTiltDeg());
+    r.temp10 = toTenths(mpuSampler.tempC());
+    r.auxTemp10[0] = RTC_NO_AUX_TEMP;
+    r.auxTemp10[1] = RTC_NO_AUX_TEMP;
+    // Aux temperatures come from whichever samplers are built in.
+    TiltedValueItem items[decltype(samplers)::ITEM_COUNT];
+    const uint8_t n = samplers.emitItems(items);
+    uint8_t aux = 0;
+    for (uint8_t i = 0; i < n && aux < 2; i++) {
+        if ((TiltedValueType)items[i].type == TiltedValueType::AuxTemp)
+            r.auxTemp10[aux++] = (int16_t)items[i].value;
+    }
+    r.batteryMv = (uint16_t)voltage;
+    r.samples = mpuSampler.samplesUsed();
+    return r;
+}
+
+// Holds a reading for the next batch, dropping the oldest if full.
+static void bufferReading(const RtcReading& r)
+{
+    if (rtcState.bufferedCount >= RTC_MAX_BUFFERED) {
+        memmove(&rtcState.buffered[0], &rtcState.buffered[1], sizeof(RtcReading) * (RTC_MAX_BUFFERED - 1));
+        rtcState.bufferedCount = RTC_MAX_BUFFERED - 1;
+    }
+    rtcState.buffered[rtcState.bufferedCount++] = r;
+}
+
+// Items of a held-back reading for its batch set, in the same order as a
+// live reading. out needs room for BUFFERED_ITEM_CAPACITY.
+static constexpr uint8_t BUFFERED_ITEM_CAPACITY = 7;
+
+static uint8_t bufferedItems(const RtcReading& r, TiltedValueItem* out)
+{
+    uint8_t n = 0;
+    out[n++] = TiltedValueHelper::makeItemI32(TiltedValueType::Tilt, r.tilt10, -1);
+    out[n++] = TiltedValueHelper::makeItemI32(TiltedValueType::Temp, r.temp10, -1);
+    out[n++] = TiltedValueHelper::sampleCount(r.samples);
+    for (int16_t aux : r.auxTemp10) {
+        if (aux != RTC_NO_AUX_TEMP)
+            out[n++] = TiltedValueHelper::makeItemI32(TiltedValueType::AuxTemp, aux, -1);
+    }
+    out[n++] = TiltedValueHelper::batteryMv(r.batteryMv);
+    out[n++] = TiltedValueHelper::sequence(r.seq);
+    return n;
+}
+
+static bool isCalibrationMode();
+
+// Sleep interval outside calibration: the gateway's if it sent one.
+static long normalInterval()
+{
+    return rtcState.cfgIntervalS ? rtcState.cfgIntervalS : NORMAL_INTERVAL;
+}
+
+// A deadband in tenths: the gateway's if it sent one, else the built-in one.
+static long deadband10(uint8_t configured, float builtIn)
+{
+    return (configured != RTC_CONFIG_DEFAULT) ? configured : lroundf(builtIn * 10.0f);
+}
+
+// Adaptive interval: records this wake's tilt and picks the next sleep
+// interval from the slope of the recent ones.
+static void adaptInterval()
+{
+    if (!TILTED_ADAPTIVE_INTERVAL || isCalibrationMode())
+        return;
+
+    const float tilt = mpuSampler.filteredTiltDeg();
+    if (!isfinite(tilt))
+        return; // keep the current interval
+
+    RtcTiltPoint* history = rtcState.tiltHistory;
+    if (rtcState.tiltHistoryCount >= RTC_TILT_HISTORY) {
+        memmove(&history[0], &history[1], sizeof(RtcTiltPoint) * (RTC_TILT_HISTORY - 1));
+        rtcState.tiltHistoryCount = RTC_TILT_HISTORY - 1;
+    }
+    history[rtcState.tiltHistoryCount++] = {rtcState.clockS, toTenths(tilt), 0};
+
+    long interval = rtcState.intervalS ? rtcState.intervalS : normalInterval();
+    const RtcTiltPoint& oldest = history[0];
+    const RtcTiltPoint& newest = history[rtcState.tiltHistoryCount - 1];
+    const uint32_t spanS = newest.atS - oldest.atS;
+    float degPerH = 0.0f;
+    if (spanS > 0) {
+        degPerH = fabsf((float)(newest.tilt10 - oldest.tilt10)) / 10.0f * 3600.0f / (float)spanS;
+        if (degPerH >= TILT_ACTIVE_DEG_PER_H) {
+            interval = normalInterval();
+        } else if (degPerH <= TILT_FLAT_DEG_PER_H && rtcState.tiltHistoryCount >= RTC_TILT_HISTORY) {
+            interval += interval / 2;
+            if (interval > TILTED_MAX_INTERVAL)
+                interval = TILTED_MAX_INTERVAL;
+        }
+    }
+
+    if ((uint32_t)interval != sleep_interval)
+        TILTED_LOGI("Interval %lu -> %ld s (tilt %.2f deg/h)\n", (unsigned long)sleep_interval, interval, degPerH);
+    rtcState.intervalS = (uint16_t)interval;
+    sleep_interval = (uint32_t)interval;
+}
+
+// True if this wake may skip its send, before looking at the reading: no
+// heartbeat due and nothing held back that has to go out.
+static bool mayStayQuiet()
+{
+    return TILTED_SKIP_UNCHANGED && !isCalibrationMode() && rtcState.bufferedCount == 0 &&
+           rtcState.sentTilt10 != RTC_NOT_SENT &&
+           (uint8_t)(rtcState.quietWakes + 1) < TILTED_HEARTBEAT_EVERY_N_WAKES;
+}
+
+// True if this wake's reading is within the deadbands of the last one the
+// gateway ACKed and its send can be skipped.
+static bool unchangedReading()
+{
+    if (!mayStayQuiet())
+        return false;
+    const int16_t tilt10 = toTenths(mpuSampler.filteredTiltDeg());
+    const int16_t temp10 = toTenths(mpuSampler.tempC());
+    if (tilt10 == RTC_NO_AUX_TEMP || temp10 == RTC_NO_AUX_TEMP)
+        return false;
+    return abs(tilt10 - rtcState.sentTilt10) <= deadband10(rtcState.cfgTiltDeadband10, TILT_DEADBAND_DEG) &&
+           abs(temp10 - rtcState.sentTemp10) <= deadband10(rtcState.cfgTempDeadband10, TEMP_DEADBAND_C);
+}
+
+// Longest the gateway should go without a frame from us, in seconds: quiet
+// wakes, then a heartbeat reading that may still be held for a batch.
+static int32_t heartbeatSeconds()
+{
+    const long interval = TILTED_ADAPTIVE_INTERVAL ? TILTED_MAX_INTERVAL : sleep_interval;
+    const long wakes = (TILTED_SKIP_UNCHANGED ? TILTED_HEARTBEAT_EVERY_N_WAKES - 1 : 0) + TRANSMIT_EVERY_N_WAKES;
+    return (int32_t)(interval * wakes);
+}
+
+// True if this wake's reading should wait for a later batch.
+static bool holdReading()
+{
+    return TRANSMIT_EVERY_N_WAKES > 1 && !isCalibrationMode() &&
+           (uint8_t)(rtcState.bufferedCount + 1) < TRANSMIT_EVERY_N_WAKES;
+}
+
+// Takes over the settings in configFrame if they are meant for us and newer
+// than the ones in use. Settings the frame leaves out revert to the defaults.
+static void applyConfigFrame()
+{
+    TiltedConfigView view{};
+    if (!tilted_decode_config_view(configFrame, configFrameLen, view) ||
+        view.header.chipId != tilted_get_chip_id32())
+        return;
+    if (view.header.version == rtcState.configVersion)
+        return;
+
+    rtcState.configVersion = view.header.version;
+    rtcState.cfgIntervalS = 0;
+    rtcState.cfgSamples = 0;
+    rtcState.cfgTiltDeadband10 = RTC_CONFIG_DEFAULT;
+    rtcState.cfgTempDeadband10 = RTC_CONFIG_DEFAULT;
+    for (const TiltedValueItem it : tilted_items(view)) {
+        const float v = TiltedValueHelper::toFloat(it);
+        if (!isfinite(v))
+            continue;
+        switch ((TiltedValueType)it.type) {
+            case TiltedValueType::IntervalS:
+                rtcState.cfgIntervalS = (uint16_t)constrain(lroundf(v), CALIBRATION_INTERVAL, TILTED_MAX_INTERVAL);
+                break;
+            case TiltedValueType::SampleCount:
+                rtcState.cfgSamples = (uint8_t)constrain(lroundf(v), 1, 255);
+                break;
+            case TiltedValueType::TiltDeadband:
+                rtcState.cfgTiltDeadband10 = (uint8_t)constrain(lroundf(v * 10.0f), 0, RTC_CONFIG_DEFAULT - 1);
+                break;
+            case TiltedValueType::TempDeadband:
+                rtcState.cfgTempDeadband10 = (uint8_t)constrain(lroundf(v * 10.0f), 0, RTC_CONFIG_DEFAULT - 1);
+                break;
+            default:
+                break; // newer than this firmware
+        }
+    }
+
+    // The interval applies from this sleep, the sample count from the next wake.
+    rtcState.intervalS = 0;
+    if (!isCalibrationMode())
+        sleep_interval = normalInterval();
+    TILTED_LOGI("Settings v%u: interval %ld s, samples %u, deadbands %ld/%ld (0.1 deg/C)\n",
+                  (unsigned)rtcState.configVersion, normalInterval(), (unsigned)rtcState.cfgSamples,
+                  deadband10(rtcState.cfgTiltDeadband10, TILT_DEADBAND_DEG),
+                  deadband10(rtcState.cfgTempDeadband10, TEMP_DEADBAND_C));
+}
 
 static void sendSensorData()
 {
-    Serial.println("Processing and sending data...");
+    TILTED_LOGD("Processing and sending data...\n");
 
     // Median-filtered tilt over our sample window.
-    float filteredValue = mpuSampler.filteredTiltDeg();
-    Serial.printf("Filtered tilt: %.2f degrees\n", filteredValue);
+    [[maybe_unused]] float filteredValue = mpuSampler.filteredTiltDeg();
+    TILTED_LOGD("Filtered tilt: %.2f degrees\n", filteredValue);
 
     // --- Build TLV readings packet (dynamic fields) ---
     // Items we currently include:
-    //  - tilt (0.1 deg)
-    //  - temperature (0.1 C)
+    //  - the samplers' items: tilt (0.1 deg), temperature (0.1 C), samples
+    //    behind the tilt (convergence may stop early), aux temperatures
     //  - battery (mV)
     //  - interval (seconds)
+    //  - the previous wake's awake and radio-on time (ms), this wake's
+    //    reset reason
+    //  - the settings version in use, on frames that ask for settings
+    //  - reading sequence number (gateway dedup / loss counting)
     TiltedValueItem items[TILTED_ITEM_CAPACITY];
-    uint8_t itemCount = 0;
-
-    items[itemCount++] = TiltedValueHelper::tiltDeg(filteredValue);
-    items[itemCount++] = TiltedValueHelper::tempC(mpuSampler.tempC());
+    uint8_t itemCount = samplers.emitItems(items);
 
-    // Optional DS18B20 aux temperature.
-#if TILTED_ENABLE_DS18B20
-    float auxTemperature = ds18b20Sampler.temperatureC();
-    if (isfinite(auxTemperature))
-    {
-        items[itemCount++] = TiltedValueHelper::auxTempC(auxTemperature);
-    }
-#endif
-    // Optional BMP280 auxiliary temperature only (no environmental pressure)
-#if defined(TILTED_ENABLE_BMP280)
-    float temperature = bmp280Sampler.temperatureC();
-    if (isfinite(temperature))
-    {
-        items[itemCount++] = TiltedValueHelper::auxTempC(temperature);
-    }
-#endif
     items[itemCount++] = TiltedValueHelper::batteryMv(voltage);
     items[itemCount++] = TiltedValueHelper::intervalS(sleep_interval);
+    items[itemCount++] = TiltedValueHelper::awakeMs(rtcState.lastAwakeMs);
+    items[itemCount++] = TiltedValueHelper::radioMs(rtcState.lastRadioMs);
+    items[itemCount++] = TiltedValueHelper::resetReason(resetReason);
+    if (TILTED_SKIP_UNCHANGED || TRANSMIT_EVERY_N_WAKES > 1)
+        items[itemCount++] = TiltedValueHelper::heartbeatS(heartbeatSeconds());
+    // Asks the gateway for settings; see TILTED_DOWNLINK.
+    const bool pollConfig = TILTED_DOWNLINK && rtcState.framesSinceConfigPoll == 0;
+    if (pollConfig)
+        items[itemCount++] = TiltedValueHelper::configVersion(rtcState.configVersion);
+    items[itemCount++] = TiltedValueHelper::sequence(rtcState.sequence);
+    // Counted up and the frame re-encoded on every resend; see resend below.
+    const uint8_t retriesIndex = itemCount;
+    items[itemCount++] = TiltedValueHelper::txRetries(0);
 
     char name[TILTED_MAX_NAME_LEN + 1];
     uint8_t nameLen = tilted_build_name_from_type(name, sizeof(name), "tilt");
     if (nameLen > TILTED_MAX_NAME_LEN)
         nameLen = TILTED_MAX_NAME_LEN;
-
-    uint16_t pktLen = tilted_readings_packet_size(nameLen, itemCount);
-    if (pktLen == 0)
-    {
-        Serial.println("TLV packet sizing failed; not sending");
-        actuallySleep();
-        return;
+    // Compact frames leave the name out once the gateway has cached it.
+    const uint8_t sentNameLen = (TILTED_COMPACT_FRAMES && rtcState.framesSinceName != 0) ? 0 : nameLen;
+
+    // Held-back readings go first, as older sets of a batch frame; this
+    // wake's reading is always the last set.
+    TiltedValueItem heldItems[RTC_MAX_BUFFERED][BUFFERED_ITEM_CAPACITY];
+    TiltedBatchSet sets[RTC_MAX_BUFFERED + 1];
+    const uint8_t held = rtcState.bufferedCount;
+    for (uint8_t i = 0; i < held; i++) {
+        const RtcReading& r = rtcState.buffered[i];
+        sets[i] = {rtcState.clockS - r.takenAtS, heldItems[i], bufferedItems(r, heldItems[i])};
     }
+    sets[held] = {0, items, itemCount};
 
-    // Initialize WiFi in STA mode
-    WiFi.forceSleepWake();
-    delay(1);
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
+    // Build packet in a stack buffer.
+    // Keep this small; ESP-NOW max payload is limited.
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint32_t chipId = tilted_get_chip_id32();
+    uint8_t firstHeld = 0;
+
+    // Encodes sets[firstHeld..held] into buf. Returns 0 if it does not fit.
+    auto encodeFrame = [&]() -> uint16_t {
+        const uint8_t setCount = (uint8_t)(held - firstHeld + 1);
+#if TILTED_COMPACT_FRAMES
+        return tilted_encode_compact_batch(buf, sizeof(buf), chipId, (uint16_t)sleep_interval,
+                                           name, sentNameLen, sets + firstHeld, setCount);
+#else
+        return (setCount > 1)
+            ? tilted_encode_batch_packet(buf, sizeof(buf), chipId, (uint16_t)sleep_interval,
+                                         name, sentNameLen, sets + firstHeld, setCount)
+            : tilted_encode_readings_packet(buf, sizeof(buf), chipId, (uint16_t)sleep_interval,
+                                            name, sentNameLen, items, itemCount);
+#endif
+    };
 
-    unsigned long espnow_start = millis();
-    unsigned long timeout = WAKE_TIMEOUT / 2;  // Shorter timeout for ESP-NOW
-    
-    bool init_success = false;
-    while ((millis() - espnow_start) < timeout) {
-        if (esp_now_init() == 0) {
-            init_success = true;
-            break;
-        }
-        delay(10);
+    // Drop the oldest held readings if they do not all fit in one frame.
+    uint16_t pktLen = encodeFrame();
+    while (pktLen == 0 && firstHeld < held) {
+        firstHeld++;
+        pktLen = encodeFrame();
     }
-    
-    if (!init_success) {
-        Serial.println("ESP-NOW init failed, sleeping without sending data");
-        actuallySleep();
-        return;
-    }
-
-    esp_now_set_self_role(ESP_NOW_ROLE_CONTROLLER);
-    esp_now_add_peer((uint8_t*)TILTED_GATEWAY_MAC, ESP_NOW_ROLE_SLAVE, TILTED_ESPNOW_CHANNEL, NULL, 0);
-
-    wifiTime = millis();
+    if (firstHeld)
+        TILTED_LOGI("Batch frame full; dropping %u oldest held reading(s)\n", (unsigned)firstHeld);
+    const uint8_t setCount = (uint8_t)(held - firstHeld + 1);
 
-    // Build packet in a stack buffer.
-    // Keep this small; ESP-NOW max payload is limited.
-    uint8_t buf[sizeof(TiltedReadingsHeader) + TILTED_MAX_NAME_LEN + sizeof(items)];
-    if (pktLen > sizeof(buf))
+    if (pktLen == 0)
     {
-        Serial.println("TLV packet too large; not sending");
+        TILTED_LOGE("Failed to encode TLV packet; not sending\n");
         actuallySleep();
         return;
     }
 
-    const uint32_t chipId = tilted_get_chip_id32();
-    const uint16_t wrote = tilted_encode_readings_packet(
-        buf,
-        sizeof(buf),
-        chipId,
-        (uint16_t)sleep_interval,
-        name,
-        nameLen,
-        items,
-        itemCount);
-
-    if (wrote != pktLen)
-    {
-        Serial.println("Failed to encode TLV packet; not sending");
+    // One more attempt: count it in the frame's TxRetries item, so the gateway
+    // sees how many sends this reading took, and resend. Varint items change
+    // length, so the frame is re-encoded rather than patched.
+    auto resend = [&](uint8_t channel) -> bool {
+        items[retriesIndex].value++;
+        pktLen = encodeFrame();
+        return pktLen != 0 && sendOnChannel(channel, buf, pktLen);
+    };
+
+    // Usually already up: bring-up started with the sample window.
+    if (!radioBringUp()) {
+        TILTED_LOGE("ESP-NOW init failed, sleeping without sending data\n");
         actuallySleep();
         return;
     }
 
-    esp_now_send(NULL, buf, pktLen); // NULL means send to all peers
+    // Combo: a controller cannot receive the gateway's config frame.
+    esp_now_set_self_role(TILTED_DOWNLINK ? ESP_NOW_ROLE_COMBO : ESP_NOW_ROLE_CONTROLLER);
+    esp_now_register_send_cb(onEspNowSent);
+    if (TILTED_DOWNLINK) {
+        configFrameLen = 0;
+        esp_now_register_recv_cb(onEspNowRecv);
+    }
+    esp_now_add_peer((uint8_t*)TILTED_GATEWAY_MAC, ESP_NOW_ROLE_SLAVE, rtcState.espnowChannel, NULL, 0);
+
+    bool acked = sendOnChannel(rtcState.espnowChannel, buf, pktLen);
+    // A NACK on the known channel is usually a collision or a busy gateway.
+    for (uint8_t retry = 0; !acked && retry < ESPNOW_SEND_RETRIES; retry++) {
+        delay(ESPNOW_RETRY_BACKOFF_MS);
+        acked = resend(rtcState.espnowChannel);
+    }
+    if (!acked) {
+        // The gateway may have followed its router to another channel.
+        TILTED_LOGI("No ACK on channel %u, sweeping\n", (unsigned)rtcState.espnowChannel);
+        for (uint8_t ch = 1; ch <= ESPNOW_MAX_CHANNEL; ch++) {
+            if (ch == rtcState.espnowChannel)
+                continue;
+            if (resend(ch)) {
+                TILTED_LOGI("Gateway found on channel %u\n", (unsigned)ch);
+                radioTrouble = true;
+                saveEspNowChannel(ch);
+                acked = true;
+                break;
+            }
+        }
+    }
     sent = millis();
+    rtcState.lastRadioMs = (uint16_t)min(sent - radioStart, 0xFFFFUL);
     
-    Serial.printf("TLV sent (name=%.*s, items=%u, len=%u)\n", nameLen, name, itemCount, pktLen);
-    Serial.println("Data sent, preparing to sleep");
-    
+    TILTED_LOGI("TLV %s (name=%.*s, items=%u, sets=%u, len=%u, ch=%u, retries=%ld)\n", acked ? "sent" : "not acked",
+                  sentNameLen, name, itemCount, (unsigned)setCount, pktLen, (unsigned)rtcState.espnowChannel,
+                  (long)items[retriesIndex].value);
+
+    if (acked) {
+        rtcState.bufferedCount = 0;
+        rtcState.sentTilt10 = toTenths(mpuSampler.filteredTiltDeg());
+        rtcState.sentTemp10 = toTenths(mpuSampler.tempC());
+        rtcState.quietWakes = 0;
+        if (TILTED_COMPACT_FRAMES)
+            rtcState.framesSinceName = (uint8_t)((rtcState.framesSinceName + 1) % TILTED_NAME_EVERY_N_FRAMES);
+        if (TILTED_DOWNLINK) {
+            if (pollConfig) {
+                // Bounded: a gateway without downlink support never answers.
+                const unsigned long listenStart = millis();
+                while (configFrameLen == 0 && (millis() - listenStart) < CONFIG_LISTEN_MS)
+                    delay(1);
+                TILTED_LOGD("Config %s after %lu ms\n", configFrameLen ? "reply" : "wait ended",
+                              millis() - listenStart);
+            }
+            if (configFrameLen != 0)
+                applyConfigFrame();
+            rtcState.framesSinceConfigPoll =
+                (uint8_t)((rtcState.framesSinceConfigPoll + 1) % TILTED_CONFIG_POLL_EVERY_N_FRAMES);
+        }
+        // Nothing left to do this cycle; deep sleep takes the radio down with it.
+        TILTED_LOGD("Data sent, sleeping\n");
+        actuallySleep(false);
+        return;
+    }
+
+    TILTED_LOGE("Data not delivered, preparing to sleep\n");
+    if (TRANSMIT_EVERY_N_WAKES > 1) {
+        // Try again with the next batch.
+        bufferReading(captureReading());
+    }
     // Clean up ESP-NOW to save power
     esp_now_deinit();
 }
@@ -313,23 +869,33 @@ void calibrationMode(bool firstIteration)
 	sleep_interval = CALIBRATION_INTERVAL;
 	if (firstIteration)
 	{
-		calibrationIterations = 1;
+		rtcState.calibrationIterations = 1;
 	}
 	else
 	{
-		calibrationIterations += 1;
+		rtcState.calibrationIterations += 1;
 	}
-	ESP.rtcUserMemoryWrite(RTC_ADDRESS, &calibrationIterations, sizeof(calibrationIterations));
 }
 
+// True while a calibration run is in progress; normalMode() ends it.
 static bool isCalibrationMode()
 {
-	return (calibrationIterations != 0) ? true : false;
+	return (rtcState.calibrationIterations != 0) ? true : false;
 }
 
 void normalMode()
 {
 	readVoltage();
+	// A finished calibration run must not keep batching, the adaptive
+	// interval and skip-unchanged off until the next power-on.
+	if (rtcState.calibrationIterations != 0)
+	{
+		TILTED_LOGI("Calibration done after %u iterations\n", (unsigned)rtcState.calibrationIterations);
+		rtcState.calibrationIterations = 0;
+	}
+	sleep_interval = normalInterval();
+	if (TILTED_ADAPTIVE_INTERVAL && rtcState.intervalS != 0)
+		sleep_interval = rtcState.intervalS;
 }
 
 // OTA update logic temporarily removed. To re-enable OTA, restore
@@ -343,19 +909,19 @@ void setup()
 	Serial.begin(74880);
 	rst_info *resetInfo;
 	resetInfo = ESP.getResetInfoPtr();
-	Serial.println("Reboot");
-
-	Serial.print("Booting because ");
-	Serial.println(ESP.getResetReason());
-
-	Serial.println("Build: " + String(versionTimestamp));
-
-	// Turn off WiFi by default to save power
+	resetReason = (uint8_t)resetInfo->reason;
+	TILTED_LOGI("Reboot\n");
+	TILTED_LOGI("Booting because %s\n", ESP.getResetReason().c_str());
+	TILTED_LOGI("Build: %s\n", versionTimestamp);
+
+	// Turn off WiFi by default to save power.
+	// Mode changes would otherwise be written to flash on every wake.
+	WiFi.persistent(false);
 	WiFi.mode(WIFI_OFF);
 	WiFi.forceSleepBegin();
 
 	// INITIALIZE MPU
-	Serial.println("Starting MPU-6050");
+	TILTED_LOGD("Starting MPU-6050\n");
     Wire.begin(SDA_PIN, SCL_PIN);
 
     // Run a non-invasive I2C scan only on power-on (not deep-sleep wake).
@@ -364,18 +930,29 @@ void setup()
     }
 
     Wire.setClock(400000);
-    mpuSampler.begin(Wire);
+    mpuSampler.begin(Wire, TILTED_MPU_INT_PIN, TILTED_MPU_FIFO);
+    mpuSampler.setOutlierRejection(TILT_OUTLIER_MAD_K);
+    mpuSampler.setConvergence(TILT_CONVERGE_MIN_SAMPLES, TILT_CONVERGE_SPREAD_DEG);
 
-    // Initialize DS18B20 (optional)
-#if TILTED_ENABLE_DS18B20
+    // Optional sensors; no-ops when not built in.
     ds18b20Sampler.begin();
-#endif
-
-#if defined(TILTED_ENABLE_BMP280)
     bmp280Sampler.begin(Wire);
-#endif
-	// Read RTC memory to get current number of calibration iterations.
-	ESP.rtcUserMemoryRead(RTC_ADDRESS, &calibrationIterations, sizeof(calibrationIterations));
+	// Read RTC memory to get the calibration counter and radio cache.
+	// It is garbage after power-on; the CRC catches that.
+	if (resetInfo->reason != REASON_DEEP_SLEEP_AWAKE || !rtcStateLoad(rtcState))
+	{
+		rtcStateDefaults(rtcState);
+	}
+	if (rtcState.espnowChannel < 1 || rtcState.espnowChannel > ESPNOW_MAX_CHANNEL)
+	{
+		saveEspNowChannel(TILTED_ESPNOW_CHANNEL);
+	}
+	// Window size pushed by the gateway, if any.
+	if (rtcState.cfgSamples != 0)
+	{
+		mpuSampler.setSampleCount(rtcState.cfgSamples);
+		mpuSampler.setConvergence(TILT_CONVERGE_MIN_SAMPLES, TILT_CONVERGE_SPREAD_DEG);
+	}
 
 
     if (resetInfo->reason != REASON_DEEP_SLEEP_AWAKE)
@@ -390,22 +967,24 @@ void setup()
             tilt = mpuSampler.filteredTiltDeg();
 			if (tilt > 0.0 && tilt > CALIBRATION_TILT_ANGLE_MIN && tilt < CALIBRATION_TILT_ANGLE_MAX)
 			{
-                Serial.println("Initiate calibration mode");
+                TILTED_LOGI("Initiate calibration mode\n");
 				calibrationMode(true);
 
 				break;
 			}
+			// Nothing time-critical while waiting for the calibration posture.
+			tilted_log_flush();
 			delay(2000);
 		}
 	}
-	else if (isCalibrationMode() && calibrationIterations < CALIBRATION_ITERATIONS)
+	else if (isCalibrationMode() && rtcState.calibrationIterations < CALIBRATION_ITERATIONS)
 	{
-		Serial.printf("Calibration mode, %d iterations...", calibrationIterations);
+		TILTED_LOGI("Calibration mode, %u iterations...\n", (unsigned)rtcState.calibrationIterations);
 		calibrationMode(false);
 	}
 	else
 	{
-		Serial.println("Normal mode");
+		TILTED_LOGI("Normal mode\n");
 		normalMode();
 	}
 
@@ -414,19 +993,17 @@ void setup()
 
 
 	currentState = STATE_SAMPLING;
-    // Ensure we always start a cycle with a fresh sample window.
-    mpuSampler.reset();
-    Serial.printf("[SAMPLE_INIT] target=%u left=%u\n", (unsigned)MAX_SAMPLES, (unsigned)mpuSampler.samplesLeft());
-
-#if TILTED_ENABLE_DS18B20
-    // Start DS18B20 conversion alongside MPU sampling.
-    ds18b20Sampler.start();
-#endif
-#if defined(TILTED_ENABLE_BMP280)
-    // BMP280 read is immediate; request a read cycle to be taken during sampling.
-    bmp280Sampler.start();
-#endif
-	Serial.println("Finished setup");
+    // Ensure we always start a cycle with a fresh sample window; DS18B20
+    // conversion and BMP280 read run alongside MPU sampling.
+    samplers.start();
+    // This wake transmits: warm the radio up while the sensors work.
+    if (TILTED_EARLY_RADIO && !holdReading() && !mayStayQuiet())
+        radioWake();
+    TILTED_LOGD("[SAMPLE_INIT] target=%u left=%u int=%d fifo=%d\n", (unsigned)mpuSampler.sampleCount(),
+                  (unsigned)mpuSampler.samplesLeft(), TILTED_MPU_INT_PIN, (int)mpuSampler.usesFifo());
+    samplingStart = millis();
+
+	TILTED_LOGD("Finished setup\n");
 }
 
 void loop()
@@ -442,51 +1019,61 @@ void loop()
             else {
                 // In fallback mode (no INT pin), sample() will still make progress.
                 // If dataReady is required/enabled, sample() will return false until ready.
-                if (mpuSampler.pending())
-                    mpuSampler.sample();
-
-#if TILTED_ENABLE_DS18B20
-                if (ds18b20Sampler.pending())
-                    ds18b20Sampler.sample();
-                #if defined(TILTED_ENABLE_BMP280)
-                    if (bmp280Sampler.pending())
-                        bmp280Sampler.sample();
-                    const bool nonePending = !mpuSampler.pending() && !ds18b20Sampler.pending() && !bmp280Sampler.pending();
-                #else
-                    const bool nonePending = !mpuSampler.pending() && !ds18b20Sampler.pending();
-                #endif
-#else
-                #if defined(TILTED_ENABLE_BMP280)
-                        if (bmp280Sampler.pending())
-                            bmp280Sampler.sample();
-                        const bool nonePending = !mpuSampler.pending() && !bmp280Sampler.pending();
-                #else
-                    const bool nonePending = !mpuSampler.pending();
-                #endif
-#endif
+                samplers.sample();
+                radioPoll();
 
                 // Move on once everything has finished its work for this cycle.
                 // We keep ready() for future changes, but we don't require it here.
-                if (nonePending) {
-                    // Put the MPU back to sleep immediately after data collection
-                    mpuSampler.sleep();
-                    Serial.println("MPU put to sleep");
-
+                if (!samplers.pending()) {
+                    // Put the sensors back to sleep immediately after data collection
+                    samplers.sleep();
+                    TILTED_LOGD("Sensors put to sleep\n");
+
+                    samplingDone = millis();
+                    TILTED_LOGD("[SAMPLE_DONE] %u samples in %lu ms\n", (unsigned)mpuSampler.samplesUsed(),
+                                  samplingDone - samplingStart);
                     currentState = STATE_PROCESSING;
                 }
             }
             
-            // mpu.getIntDataReadyStatus() hits the I2C bus. We don't need
-			// to poll every ms while we're gathering samples. Once we have
-			// the samples we're just waiting for the transmit to clear, so
-			// loop a bit quicker.
-            // Poll slower while we're gathering samples.
-			delay((mpuSampler.samplesLeft() > 0) ? SAMPLE_DELAY_MS : 1);
+            // Sleep until the earliest sensor or radio deadline, so the
+            // DS18B20 conversion, the MPU window and ESP-NOW start-up run
+            // side by side and the cycle lasts as long as the slowest of
+            // them. Polling the MPU hits the I2C bus, so it is only checked
+            // once a sample is due. With the INT pin wired, the wait ends as
+            // soon as a sample is flagged.
+            if (currentState == STATE_SAMPLING) {
+                uint32_t waitMs = samplers.msUntilReady();
+                const uint32_t radioMs = radioMsUntilReady();
+                if (radioPhase == RADIO_STARTING && radioMs < waitMs)
+                    waitMs = radioMs;
+                if (waitMs > 0 && mpuSampler.usesInterrupt() && mpuSampler.pending())
+                    mpuSampler.waitForData(waitMs);
+                else if (waitMs > 0)
+                    delay(waitMs);
+            }
             break;
             
         case STATE_PROCESSING:
-            // Process data and prepare for transmission
-            currentState = STATE_TRANSMITTING;
+            // Process data and prepare for transmission. The radio is
+            // normally up by now, so the frame goes out as soon as it is built.
+            adaptInterval();
+            if (unchangedReading()) {
+                rtcState.quietWakes++;
+                TILTED_LOGI("Reading unchanged; skipping send (%u/%u)\n", (unsigned)rtcState.quietWakes,
+                              (unsigned)TILTED_HEARTBEAT_EVERY_N_WAKES);
+                currentState = STATE_SLEEPING;
+                break;
+            }
+            rtcState.sequence++;
+            if (holdReading()) {
+                bufferReading(captureReading());
+                TILTED_LOGI("Reading held for batch (%u/%u)\n", (unsigned)rtcState.bufferedCount,
+                              (unsigned)TRANSMIT_EVERY_N_WAKES);
+                currentState = STATE_SLEEPING;
+            } else {
+                currentState = STATE_TRANSMITTING;
+            }
             break;
             
         case STATE_TRANSMITTING:
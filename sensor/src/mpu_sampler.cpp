@@ -1,33 +1,62 @@
 #include "mpu_sampler.h"
-#include <RunningMedian.h>
+
+#include <new>
+
+#include "tilted_value_helper.h"
+
+// Set by the INT pin ISR, cleared when the sample is consumed. There is only
+// one MPU, so a file-level flag is enough.
+static volatile bool mpuDataReady = false;
+
+static void IRAM_ATTR onMpuInterrupt()
+{
+	mpuDataReady = true;
+}
 
 // The upstream MPU6050 library can be constructed with a specific TwoWire instance.
-// We use dynamic allocation here so the sampler can switch buses at runtime and the
-// object can be constructed after the bus is chosen.
+// It is constructed in place in begin() so the sampler can switch buses at
+// runtime and the object can be constructed after the bus is chosen, without
+// touching the heap.
 
 MpuSampler::MpuSampler(uint8_t sampleCount) { 
-	runningMedian_ = new RunningMedian(sampleCount);
+	setSampleCount(sampleCount);
 	reset(); 
 }
 
+void MpuSampler::setSampleCount(uint8_t sampleCount)
+{
+	sampleCount_ = (sampleCount > MAX_WINDOW) ? MAX_WINDOW : sampleCount;
+}
+
 void MpuSampler::reset()
 {
-	runningMedian_->clear();
+	filter_.clear();
 	tempC_ = NAN;
+	fifoDone_ = false;
+	readyAtMs_ = millis();
+	if (fifo_ && mpu_ != nullptr)
+		restartFifo_();
 }
 
-void MpuSampler::begin(TwoWire& wire)
+void MpuSampler::begin(TwoWire& wire, int intPin, bool useFifo)
 {
 	wire_ = &wire;
+	fifo_ = useFifo && sampleCount_ > 0;
+	if (fifo_)
+		intPin = -1; // one burst per window; per-sample interrupts buy nothing
+
+	if (intPin_ >= 0)
+		detachInterrupt(digitalPinToInterrupt(intPin_));
+	intPin_ = intPin;
 
 	if (mpu_ != nullptr)
 	{
-		delete mpu_;
+		mpu_->~MPU6050();
 		mpu_ = nullptr;
 	}
 
 	// This MPU6050 library supports selecting the I2C bus via the wireObj arg.
-	mpu_ = new MPU6050(MPU6050_DEFAULT_ADDRESS, static_cast<void*>(wire_));
+	mpu_ = new (mpuStorage_) MPU6050(MPU6050_DEFAULT_ADDRESS, static_cast<void*>(wire_));
 
 	mpu_->initialize();
 	mpu_->setFullScaleAccelRange(MPU6050_ACCEL_FS_2);
@@ -38,32 +67,136 @@ void MpuSampler::begin(TwoWire& wire)
 	mpu_->setInterruptMode(1);  // Active Low
 	mpu_->setInterruptDrive(1); // Open drain
 	mpu_->setRate(17);
-	// Data-ready interrupt is optional depending on wiring. We still gate sampling
-	// on the status bit which the library reads over I2C.
+	// Data-ready interrupt is optional depending on wiring. Without it we gate
+	// sampling on the status bit which the library reads over I2C.
 	mpu_->setIntDataReadyEnabled(true);
 
+	if (intPin_ >= 0)
+	{
+		// Active-low, open-drain pulse (see above); the MPU needs the pull-up.
+		mpuDataReady = false;
+		pinMode(intPin_, INPUT_PULLUP);
+		attachInterrupt(digitalPinToInterrupt(intPin_), onMpuInterrupt, FALLING);
+	}
+
 	initialized_ = true;
 
 	// Ensure we're awake.
 	mpu_->setSleepEnabled(false);
+
+	if (fifo_)
+	{
+		mpu_->setAccelFIFOEnabled(true);
+		mpu_->setFIFOEnabled(true);
+		restartFifo_();
+	}
+}
+
+void MpuSampler::restartFifo_()
+{
+	mpu_->resetFIFO();
+	// One spare period so the last sample has landed.
+	readyAtMs_ = millis() + (uint32_t)(sampleCount_ + 1) * SAMPLE_PERIOD_MS;
+}
+
+uint32_t MpuSampler::msUntilReady() const
+{
+	if (intPin_ >= 0 && mpuDataReady)
+		return 0;
+	const int32_t left = (int32_t)(readyAtMs_ - millis());
+	return (left > 0) ? (uint32_t)left : 0;
+}
+
+bool MpuSampler::sampleFifo_()
+{
+	const uint16_t needed = (uint16_t)sampleCount_ * FIFO_BYTES_PER_SAMPLE;
+	const uint16_t count = mpu_->getFIFOCount();
+	if (count >= FIFO_SIZE)
+	{
+		// Overflowed (e.g. the caller stalled); the contents are no longer aligned.
+		restartFifo_();
+		return false;
+	}
+	if (count < needed)
+	{
+		readyAtMs_ = millis() + SAMPLE_PERIOD_MS;
+		return false;
+	}
+
+	uint8_t raw[MAX_WINDOW * FIFO_BYTES_PER_SAMPLE];
+	mpu_->getFIFOBytes(raw, (uint8_t)needed);
+
+	filter_.clear();
+	for (uint8_t i = 0; i < sampleCount_; i++)
+	{
+		const uint8_t* s = raw + i * FIFO_BYTES_PER_SAMPLE;
+		const int16_t ax = (int16_t)((s[0] << 8) | s[1]);
+		const int16_t ay = (int16_t)((s[2] << 8) | s[3]);
+		const int16_t az = (int16_t)((s[4] << 8) | s[5]);
+
+		// Same axis mapping as getAcceleration(&ax, &az, &ay) in sample().
+		const float tilt = calculateTiltDeg_(ax, ay, az);
+		if (tilt > 0.0f && tilt != 90.0f)
+			filter_.add(tilt);
+	}
+
+	if (filter_.count() == 0)
+	{
+		restartFifo_();
+		return false;
+	}
+	fifoDone_ = true;
+
+	tempC_ = mpu_->getTemperature() / 340.0f + 36.53f;
+	return true;
 }
 
 void MpuSampler::sleep()
 {
+	if (intPin_ >= 0)
+		detachInterrupt(digitalPinToInterrupt(intPin_));
 	if (mpu_ != nullptr)
 		mpu_->setSleepEnabled(true);
 }
 
+bool MpuSampler::waitForData(uint32_t timeoutMs)
+{
+	if (intPin_ < 0)
+		return dataReady();
+
+	// delay() hands the CPU to the SDK between checks rather than spinning on
+	// I2C. (esp_delay() with a wake predicate would do this but needs core 3.1.)
+	const uint32_t start = millis();
+	while (!mpuDataReady && (millis() - start) < timeoutMs)
+		delay(1);
+	return mpuDataReady;
+}
+
 bool MpuSampler::sample()
 {
 	if (!initialized_ || isComplete())
 		return false;
 	if (mpu_ == nullptr)
 		return false;
-	if (runningMedian_ == nullptr)
-		return false;
-	if (!mpu_->getIntDataReadyStatus())
+	if (fifo_)
+		return sampleFifo_();
+	if (intPin_ >= 0)
+	{
+		if (!mpuDataReady)
+		{
+			// Not flagged yet; callers waiting in waitForData() wake on the ISR.
+			readyAtMs_ = millis() + SAMPLE_PERIOD_MS;
+			return false;
+		}
+		mpuDataReady = false;
+	}
+	else if (!mpu_->getIntDataReadyStatus())
+	{
+		// Early (the rate is only nominal): poll again shortly.
+		readyAtMs_ = millis() + 1;
 		return false;
+	}
+	readyAtMs_ = millis() + SAMPLE_PERIOD_MS;
 
 	int16_t ax, ay, az;
 	mpu_->getAcceleration(&ax, &az, &ay);
@@ -74,7 +207,7 @@ bool MpuSampler::sample()
 	// Both of these indicate failures to read correct data from the MPU.
 	if (tilt > 0.0f && tilt != 90.0f)
 	{
-		runningMedian_->add(tilt);
+		filter_.add(tilt);
 
 		if (isComplete())
 		{
@@ -90,40 +223,62 @@ bool MpuSampler::sample()
 
 bool MpuSampler::dataReady() const
 {
-	if (!initialized_ || isComplete() || mpu_ == nullptr || runningMedian_ == nullptr)
+	if (!initialized_ || isComplete() || mpu_ == nullptr)
 		return false;
+	if (fifo_)
+		return mpu_->getFIFOCount() >= (uint16_t)sampleCount_ * FIFO_BYTES_PER_SAMPLE;
+	if (intPin_ >= 0)
+		return mpuDataReady;
 	return mpu_->getIntDataReadyStatus();
 }
 
 float MpuSampler::filteredTiltDeg() const
 {
-	if (runningMedian_ == nullptr || runningMedian_->getCount() == 0)
+	if (filter_.count() == 0)
 		return NAN;
 
-	return runningMedian_->getMedian();
+	// Results are cached by the filter, so repeated calls are cheap.
+	return filter_.madMean(outlierMadK_);
 }
 
 uint8_t MpuSampler::samplesLeft() const
 {
-	if (runningMedian_ == nullptr)
+	if (fifo_)
+		return fifoDone_ ? 0 : sampleCount_;
+	if (isComplete())
 		return 0;
-	const uint8_t cnt = static_cast<uint8_t>(runningMedian_->getCount());
-	const uint8_t size = static_cast<uint8_t>(runningMedian_->getSize());
-	return (size > cnt) ? (size - cnt) : 0;
+	const uint8_t cnt = filter_.count();
+	return (sampleCount_ > cnt) ? (sampleCount_ - cnt) : 0;
+}
+
+void MpuSampler::setConvergence(uint8_t minSamples, float spreadDeg)
+{
+	convergeMinSamples_ = (minSamples > sampleCount_) ? sampleCount_ : minSamples;
+	convergeSpreadDeg_ = spreadDeg;
 }
 
 bool MpuSampler::isComplete() const
 {
-	if (runningMedian_ == nullptr)
-		return false;
-	return runningMedian_->getCount() >= runningMedian_->getSize();
+	if (fifo_)
+		return fifoDone_;
+	const uint8_t cnt = filter_.count();
+	if (cnt >= sampleCount_)
+		return true;
+	// spread() is cached by the filter until the next sample.
+	return convergeMinSamples_ > 0 && cnt >= convergeMinSamples_ && filter_.spread() <= convergeSpreadDeg_;
+}
+
+uint8_t MpuSampler::emitItems(TiltedValueItem* out) const
+{
+	out[0] = TiltedValueHelper::tiltDeg(filteredTiltDeg());
+	out[1] = TiltedValueHelper::tempC(tempC_);
+	out[2] = TiltedValueHelper::sampleCount(samplesUsed());
+	return 3;
 }
 
 bool MpuSampler::pending() const
 {
-	if (runningMedian_ == nullptr)
-		return false;
-	return initialized_ && (runningMedian_->getSize() > 0) && !isComplete();
+	return initialized_ && (sampleCount_ > 0) && !isComplete();
 }
 
 bool MpuSampler::ready() const
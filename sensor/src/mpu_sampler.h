@@ -5,7 +5,8 @@
 
 #include "MPU6050.h"
 
-class RunningMedian;
+#include "tilt_filter.h"
+#include "tilted_protocol.h"
 
 // Simple MPU6050 sampler that collects N tilt samples and one temperature sample.
 //
@@ -19,14 +20,40 @@ class RunningMedian;
 //  }
 //  float tilt = mpu.filteredTiltDeg();
 //  float temp = mpu.tempC();
+//
+// Interrupt mode: pass the GPIO wired to the MPU INT pin to begin(). An ISR
+// then flags each new sample, so sample() no longer reads the status register
+// over I2C and waitForData() can yield until the data is there instead of
+// polling on a fixed delay.
+//
+// FIFO mode: the MPU queues accelerometer samples itself. sample() returns
+// false until the whole window is buffered, then drains it in one burst read
+// and takes the median in place. Wait msUntilReady() between calls.
 class MpuSampler {
 public:
 	explicit MpuSampler(uint8_t sampleCount);
 
 	// Assumes the bus has already been started by the caller (e.g. Wire.begin()).
-	void begin(TwoWire& wire);
+	// intPin < 0 keeps the I2C polling mode. useFifo takes precedence over intPin.
+	void begin(TwoWire& wire, int intPin = -1, bool useFifo = false);
 	void reset();
 
+	// SamplerSet interface (see sampler_set.h). Emits tilt, temperature and
+	// the sample count.
+	static constexpr uint8_t ITEM_COUNT = 3;
+	void start() { reset(); }
+	// Next data-ready, estimated from the sample rate between I2C polls; in
+	// FIFO mode, when the window should be buffered.
+	uint32_t msUntilReady() const;
+	uint8_t emitItems(TiltedValueItem* out) const;
+
+	bool usesInterrupt() const { return intPin_ >= 0; }
+	bool usesFifo() const { return fifo_; }
+
+	// Interrupt mode only: yields to the SDK until the MPU signals a new sample
+	// or timeoutMs passes. Returns true if a sample is ready.
+	bool waitForData(uint32_t timeoutMs);
+
 	// Returns true if a sample was consumed (i.e., we recorded a tilt reading).
 	bool sample();
 
@@ -46,6 +73,24 @@ public:
 	// Median-filtered tilt in degrees for the collected sample window.
 	float filteredTiltDeg() const;
 
+	// With madK > 0, filteredTiltDeg() instead averages the samples within
+	// madK scaled MADs of the median, dropping outliers. 0 = plain median.
+	void setOutlierRejection(float madK) { outlierMadK_ = madK; }
+
+	// Convergence mode: stop once at least minSamples are in and their spread
+	// (max - min) is within spreadDeg; sampleCount stays the maximum, so a
+	// still fermenter finishes early. minSamples = 0 disables it.
+	// FIFO mode always reads the full window.
+	void setConvergence(uint8_t minSamples, float spreadDeg);
+
+	// Changes the window size (capped at MAX_WINDOW) from the next reset().
+	// Call setConvergence() again afterwards; it is capped by the window.
+	void setSampleCount(uint8_t sampleCount);
+	uint8_t sampleCount() const { return sampleCount_; }
+
+	// Tilt samples behind filteredTiltDeg().
+	uint8_t samplesUsed() const { return filter_.count(); }
+
 	// Sampled temperature in degrees C (taken when sampling completes).
 	float tempC() const { return tempC_; }
 
@@ -55,11 +100,35 @@ public:
 private:
 	static float calculateTiltDeg_(float ax, float az, float ay);
 
-	RunningMedian* runningMedian_ = nullptr;
+	void restartFifo_();
+	bool sampleFifo_();
+
+	// Accelerometer-only FIFO: X, Y, Z as big-endian int16.
+	static constexpr uint8_t FIFO_BYTES_PER_SAMPLE = 6;
+	static constexpr uint16_t FIFO_SIZE = 1024;
+	// Sample period for setRate(17) with the DLPF on: (1 + 17) / 1 kHz.
+	static constexpr uint8_t SAMPLE_PERIOD_MS = 18;
+
+	// Largest sample window; also bounds the FIFO burst (stack buffer size).
+	static constexpr uint8_t MAX_WINDOW = 16;
+
+	TiltFilter<MAX_WINDOW> filter_;
+	float outlierMadK_ = 0.0f;
+	uint8_t convergeMinSamples_ = 0;
+	float convergeSpreadDeg_ = 0.0f;
+
 	TwoWire* wire_ = nullptr;
+	// mpu_ points into mpuStorage_ once begin() has run.
+	alignas(MPU6050) uint8_t mpuStorage_[sizeof(MPU6050)];
 	MPU6050* mpu_ = nullptr;
 
 	float tempC_ = NAN;
 
+	int intPin_ = -1;
 	bool initialized_ = false;
+
+	uint8_t sampleCount_ = 0;
+	bool fifo_ = false;
+	bool fifoDone_ = false;
+	uint32_t readyAtMs_ = 0;
 };
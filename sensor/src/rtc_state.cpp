@@ -0,0 +1,58 @@
+#include "rtc_state.h"
+
+#include <stddef.h>
+
+#include "tilted_protocol.h"
+
+// The state starts at the first RTC user memory block.
+static constexpr uint32_t RTC_STATE_OFFSET = 0;
+
+static uint32_t crc32(const uint8_t* data, size_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	while (len--)
+	{
+		crc ^= *data++;
+		for (uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+	}
+	return ~crc;
+}
+
+static uint32_t stateCrc(const RtcState& state)
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(&state);
+	return crc32(p + sizeof(state.crc), sizeof(state) - sizeof(state.crc));
+}
+
+void rtcStateDefaults(RtcState& state)
+{
+	memset(&state, 0, sizeof(state));
+	state.version = RTC_STATE_VERSION;
+	state.size = sizeof(state);
+	state.espnowChannel = TILTED_ESPNOW_CHANNEL;
+	state.sentTilt10 = RTC_NOT_SENT;
+	state.sentTemp10 = RTC_NOT_SENT;
+	state.cfgTiltDeadband10 = RTC_CONFIG_DEFAULT;
+	state.cfgTempDeadband10 = RTC_CONFIG_DEFAULT;
+}
+
+bool rtcStateLoad(RtcState& state)
+{
+	if (ESP.rtcUserMemoryRead(RTC_STATE_OFFSET, reinterpret_cast<uint32_t*>(&state), sizeof(state)) &&
+	    state.version == RTC_STATE_VERSION &&
+	    state.size == sizeof(state) &&
+	    state.crc == stateCrc(state))
+		return true;
+
+	rtcStateDefaults(state);
+	return false;
+}
+
+void rtcStateSave(RtcState& state)
+{
+	state.version = RTC_STATE_VERSION;
+	state.size = sizeof(state);
+	state.crc = stateCrc(state);
+	ESP.rtcUserMemoryWrite(RTC_STATE_OFFSET, reinterpret_cast<uint32_t*>(&state), sizeof(state));
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Everything the sensor carries across deep sleep, kept in RTC user memory.
+//
+// RTC memory survives deep sleep but is garbage after power-on, so the block
+// is versioned and CRC-protected: load() falls back to defaults whenever the
+// CRC, version or size does not match. Bump RTC_STATE_VERSION when changing
+// the layout.
+//
+// Usage:
+//   RtcState state;
+//   if (!rtcStateLoad(state)) { /* power-on or layout change: defaults */ }
+//   state.calibrationIterations++;
+//   rtcStateSave(state); // once, right before deep sleep
+static constexpr uint16_t RTC_STATE_VERSION = 8;
+
+// A reading held back for a later batch frame.
+struct RtcReading
+{
+	uint32_t takenAtS;    // RtcState::clockS when it was taken
+	uint32_t seq;         // RtcState::sequence it was numbered with
+	int16_t tilt10;       // 0.1 deg
+	int16_t temp10;       // 0.1 C
+	int16_t auxTemp10[2]; // 0.1 C, RTC_NO_AUX_TEMP if absent
+	uint16_t batteryMv;
+	uint8_t samples;
+	uint8_t reserved;
+};
+
+static constexpr int16_t RTC_NO_AUX_TEMP = INT16_MIN;
+static constexpr int16_t RTC_NOT_SENT = INT16_MIN;
+static constexpr uint8_t RTC_MAX_BUFFERED = 8;
+static constexpr uint8_t RTC_CONFIG_DEFAULT = 0xFF;
+
+// A filtered tilt reading, for the adaptive interval's slope.
+struct RtcTiltPoint
+{
+	uint32_t atS;   // RtcState::clockS when it was taken
+	int16_t tilt10; // 0.1 deg
+	uint16_t reserved;
+};
+
+static constexpr uint8_t RTC_TILT_HISTORY = 4;
+
+struct RtcState
+{
+	uint32_t crc;     // CRC-32 over everything after this field
+	uint16_t version; // RTC_STATE_VERSION
+	uint16_t size;    // sizeof(RtcState)
+
+	uint32_t calibrationIterations; // 0 outside a calibration run
+
+	// Radio bring-up cache.
+	uint8_t espnowChannel;    // last channel the gateway ACKed on
+	uint8_t wakesSinceRfCal;  // wakes since the last full RF calibration
+	uint8_t lastInitAttempts; // esp_now_init() calls needed last wake (0 = failed)
+	uint8_t radioFlags;       // RTC_RADIO_* bits
+	uint16_t lastInitMs;      // radio wake + esp_now_init() cost last wake
+	uint16_t lastRadioMs;     // radio on until the frame was sent, last wake (0 = off)
+	uint16_t lastAwakeMs;     // boot to deep sleep, last wake
+
+	// Adaptive interval in use, s; 0 = the fixed normal interval.
+	uint16_t intervalS;
+
+	// Last reading the gateway ACKed, for skipping unchanged ones (0.1 deg /
+	// 0.1 C, RTC_NOT_SENT after power-on).
+	int16_t sentTilt10;
+	int16_t sentTemp10;
+
+	// Settings pushed by the gateway. RTC only: after power-on the first frame
+	// asks for them again. 0 / RTC_CONFIG_DEFAULT = the built-in value.
+	uint16_t configVersion;    // 0 = none applied
+	uint16_t cfgIntervalS;
+	uint8_t cfgSamples;
+	uint8_t cfgTiltDeadband10; // 0.1 deg
+	uint8_t cfgTempDeadband10; // 0.1 C
+	// ACKed frames since the last one that asked for settings.
+	uint8_t framesSinceConfigPoll;
+
+	// Sensor-relative clock: seconds slept plus seconds awake, summed over
+	// wakes. Only differences are meaningful (reading ages in a batch).
+	uint32_t clockS;
+
+	// Number of the last reading taken; the gateway drops repeats and counts gaps.
+	uint32_t sequence;
+
+	// Readings waiting to go out in a batch, oldest first.
+	uint8_t bufferedCount;
+	// Compact frames sent since the last one carrying the sensor name.
+	uint8_t framesSinceName;
+	uint8_t tiltHistoryCount;
+	// Wakes skipped as unchanged since the last ACKed frame.
+	uint8_t quietWakes;
+	RtcReading buffered[RTC_MAX_BUFFERED];
+
+	// Recent filtered tilts, oldest first.
+	RtcTiltPoint tiltHistory[RTC_TILT_HISTORY];
+};
+
+// Station auto-connect has been turned off in flash, so waking the radio
+// cannot start an association we would have to cancel.
+static constexpr uint8_t RTC_RADIO_AUTOCONNECT_OFF = 0x01;
+
+static_assert(sizeof(RtcReading) == 20, "Unexpected RtcReading size");
+static_assert(sizeof(RtcTiltPoint) == 8, "Unexpected RtcTiltPoint size");
+static_assert(sizeof(RtcState) % 4 == 0, "RTC user memory is word addressed");
+static_assert(sizeof(RtcState) <= 512, "RTC user memory is 512 bytes");
+
+// Fills state with defaults. Used on power-on and after a layout change.
+void rtcStateDefaults(RtcState& state);
+
+// Returns false (and fills defaults) if RTC memory does not hold a valid state.
+bool rtcStateLoad(RtcState& state);
+
+// Stamps version/size/CRC and writes the state.
+void rtcStateSave(RtcState& state);
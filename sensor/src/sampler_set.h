@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <tuple>
+
+#include "tilted_protocol.h"
+
+// The samplers behind one wake's reading, composed at compile time.
+//
+// Each sampler provides:
+//   static constexpr uint8_t ITEM_COUNT;           // most items it emits
+//   void start();                                  // begin a reading cycle
+//   bool sample();                                 // make progress
+//   bool pending() const;                          // still working
+//   uint32_t msUntilReady() const;                 // while pending: ms until
+//                                                  // sample() has work, 0 = now
+//   void sleep();                                  // low power until next wake
+//   uint8_t emitItems(TiltedValueItem* out) const; // its TLV items, returns count
+//
+// A sensor that is compiled out is listed as NoSampler: everything inlines to
+// nothing, so it costs no code and no cycles.
+//
+// Usage:
+//   static SamplerSet<MpuSampler, Ds18b20Sampler> samplers(mpu, ds18b20);
+//   TiltedValueItem items[decltype(samplers)::ITEM_COUNT + 4];
+//   samplers.start();
+//   while (samplers.pending()) {
+//     samplers.sample();
+//     delay(samplers.msUntilReady());
+//   }
+//   uint8_t n = samplers.emitItems(items);
+template <typename... Samplers>
+class SamplerSet {
+public:
+	static constexpr uint8_t ITEM_COUNT = (0 + ... + Samplers::ITEM_COUNT);
+
+	explicit SamplerSet(Samplers&... samplers) : samplers_(samplers...) {}
+
+	void start()
+	{
+		std::apply([](auto&... s) { (s.start(), ...); }, samplers_);
+	}
+
+	// Gives every sampler that is still working a turn.
+	void sample()
+	{
+		std::apply([](auto&... s) { ((void)(s.pending() && s.sample()), ...); }, samplers_);
+	}
+
+	bool pending() const
+	{
+		return std::apply([](const auto&... s) { return (false || ... || s.pending()); }, samplers_);
+	}
+
+	// Time until the first pending sampler has work; 0 if one has work now
+	// or none is pending. Sleeping this long keeps the sensors' waits
+	// overlapped, so a cycle takes as long as its slowest sensor.
+	uint32_t msUntilReady() const
+	{
+		uint32_t soonest = UINT32_MAX;
+		std::apply([&](const auto&... s) {
+			((s.pending() ? (void)(soonest = earlier(soonest, s.msUntilReady())) : (void)0), ...);
+		}, samplers_);
+		return (soonest == UINT32_MAX) ? 0 : soonest;
+	}
+
+	void sleep()
+	{
+		std::apply([](auto&... s) { (s.sleep(), ...); }, samplers_);
+	}
+
+	// Writes every sampler's items, in list order. out needs ITEM_COUNT slots.
+	uint8_t emitItems(TiltedValueItem* out) const
+	{
+		uint8_t n = 0;
+		std::apply([&](const auto&... s) { ((n += s.emitItems(out + n)), ...); }, samplers_);
+		return n;
+	}
+
+private:
+	static uint32_t earlier(uint32_t a, uint32_t b) { return (a < b) ? a : b; }
+
+	std::tuple<Samplers&...> samplers_;
+};
+
+// Placeholder for a sensor that is not built in.
+struct NoSampler {
+	static constexpr uint8_t ITEM_COUNT = 0;
+
+	template <typename... Args>
+	void begin(Args&&...) {}
+	void start() {}
+	bool sample() { return false; }
+	bool pending() const { return false; }
+	uint32_t msUntilReady() const { return 0; }
+	void sleep() {}
+	uint8_t emitItems(TiltedValueItem*) const { return 0; }
+};
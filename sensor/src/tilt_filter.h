@@ -0,0 +1,129 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+// Fixed-capacity window of tilt samples with median-based estimators.
+// Storage is inline (no heap); selection is done in place, so add() order is
+// not preserved once a statistic has been taken. Results are cached until
+// the next add()/clear().
+//
+// Usage:
+//   TiltFilter<16> f;
+//   f.add(a); f.add(b); f.add(c);
+//   float m = f.median();
+//   float r = f.madMean(3.0f); // mean of samples within 3 scaled MADs of the median
+template <uint8_t Capacity>
+class TiltFilter
+{
+	static_assert(Capacity > 0, "Capacity must be non-zero");
+
+public:
+	static constexpr uint8_t capacity() { return Capacity; }
+
+	void clear()
+	{
+		count_ = 0;
+		dirty_ = true;
+	}
+
+	// Returns false once the window is full.
+	bool add(float v)
+	{
+		if (count_ >= Capacity)
+			return false;
+		values_[count_++] = v;
+		dirty_ = true;
+		return true;
+	}
+
+	uint8_t count() const { return count_; }
+	bool full() const { return count_ >= Capacity; }
+
+	float median() const
+	{
+		update();
+		return median_;
+	}
+
+	// Spread of the window (max - min).
+	float spread() const
+	{
+		update();
+		return spread_;
+	}
+
+	// Mean of the samples within k * 1.4826 * MAD of the median (1.4826 makes
+	// the MAD a standard-deviation estimate for normal noise). Rejects the odd
+	// knocked or bubble-jolted reading without needing a larger window.
+	// k <= 0 returns the median. The result for the last k is cached too.
+	float madMean(float k) const
+	{
+		update();
+		if (count_ == 0 || k <= 0.0f)
+			return median_;
+		if (k == madK_)
+			return madMean_;
+
+		float dev[Capacity];
+		for (uint8_t i = 0; i < count_; i++)
+			dev[i] = fabsf(values_[i] - median_);
+		const float mad = select(dev, count_);
+		const float limit = k * 1.4826f * mad;
+
+		float sum = 0.0f;
+		uint8_t kept = 0;
+		for (uint8_t i = 0; i < count_; i++)
+		{
+			if (fabsf(values_[i] - median_) <= limit)
+			{
+				sum += values_[i];
+				kept++;
+			}
+		}
+		madK_ = k;
+		madMean_ = kept ? sum / kept : median_;
+		return madMean_;
+	}
+
+private:
+	// Median of v[0..n), reordering v. Averages the middle pair for even n.
+	static float select(float* v, uint8_t n)
+	{
+		const uint8_t mid = n / 2;
+		std::nth_element(v, v + mid, v + n);
+		const float upper = v[mid];
+		if (n & 1)
+			return upper;
+		// After nth_element everything before mid is <= upper; the lower middle is their max.
+		return (*std::max_element(v, v + mid) + upper) / 2.0f;
+	}
+
+	void update() const
+	{
+		if (!dirty_)
+			return;
+		dirty_ = false;
+		madK_ = NAN; // equal to no k
+		if (count_ == 0)
+		{
+			median_ = NAN;
+			spread_ = NAN;
+			return;
+		}
+		const auto mm = std::minmax_element(values_, values_ + count_);
+		spread_ = *mm.second - *mm.first;
+		median_ = select(values_, count_);
+	}
+
+	// mutable: statistics reorder the samples and cache the result.
+	mutable float values_[Capacity]{};
+	mutable float median_ = NAN;
+	mutable float spread_ = NAN;
+	mutable float madK_ = NAN;
+	mutable float madMean_ = NAN;
+	mutable bool dirty_ = true;
+	uint8_t count_ = 0;
+};
@@ -36,6 +36,9 @@ type Reading struct {
 	Temp     float64 `json:"temp"`
 	Volt     float64 `json:"volt"`
 	Interval int     `json:"interval"`
+	// Timestamp is the unix time (seconds) the reading was taken, when the
+	// gateway knows it (replayed readings). Zero means "now".
+	Timestamp int64 `json:"timestamp,omitempty"`
 }
 
 // DataPoint represents a point of data for frontend visualization
@@ -81,7 +84,7 @@ func main() {
 	// Routes
 	e.POST("/api/readings", handleSensorData)
 	// Accept raw gateway JSON produced by the ESP32 gateway (the
-	// JSON produced by EspNowReceiver::takePendingJson()). This makes it
+	// JSON produced by EspNowReceiver::peekPending()). This makes it
 	// trivial to point the gateway's Brewfather URL at this server so the
 	// server can persist and optionally forward readings.
 	e.POST("/api/publish", handleGatewayJson)
@@ -250,6 +253,12 @@ func handleSensorData(c echo.Context) error {
 
 // saveToDatabase stores the sensor readings in SQLite with normalized schema
 func saveToDatabase(data *SensorReading) error {
+	return saveAllToDatabase([]*SensorReading{data})
+}
+
+// saveAllToDatabase stores several readings in one transaction: either all
+// of them are saved or none is, so a sender can safely retry the whole set.
+func saveAllToDatabase(readings []*SensorReading) (err error) {
 	// Get a connection from the pool
 	conn, err := dbPool.Take(context.Background())
 	if err != nil {
@@ -264,11 +273,24 @@ func saveToDatabase(data *SensorReading) error {
 		endTx(&err)
 	}()
 
+	for _, data := range readings {
+		if err = insertReading(conn, data); err != nil {
+			return err
+		}
+	}
+
+	log.Printf("Successfully saved %d reading(s) to SQLite database", len(readings))
+	return nil
+}
+
+// insertReading adds one reading (and its sensor and gateway, if new) on
+// conn, inside the caller's transaction.
+func insertReading(conn *sqlite.Conn, data *SensorReading) error {
 	// 1. Get or create sensor ID
 	var sensorInternalID int64
 
 	found := false
-	err = sqlitex.Execute(conn,
+	err := sqlitex.Execute(conn,
 		"SELECT id FROM sensors WHERE sensor_id = ?",
 		&sqlitex.ExecOptions{
 			Args: []any{data.Reading.SensorID},
@@ -348,8 +370,11 @@ func saveToDatabase(data *SensorReading) error {
 		}
 	}
 
-	// 3. Insert reading with the current timestamp
+	// 3. Insert reading with its own timestamp if it has one, else the current time
 	timestamp := time.Now().UnixMilli()
+	if data.Reading.Timestamp > 0 {
+		timestamp = data.Reading.Timestamp * 1000
+	}
 	err = sqlitex.Execute(conn,
 		`INSERT INTO readings (
 			timestamp, sensor_id, gateway_id, gravity, tilt, temp, volt, interval
@@ -364,8 +389,6 @@ func saveToDatabase(data *SensorReading) error {
 	if err != nil {
 		return fmt.Errorf("failed to insert reading: %v", err)
 	}
-
-	log.Printf("Successfully saved metrics to SQLite database")
 	return nil
 }
 
@@ -541,14 +564,67 @@ func getSensorData(c echo.Context) error {
 }
 
 // handleGatewayJson accepts the lightweight JSON produced by the ESP32
-// gateway (EspNowReceiver::takePendingJson) and maps it into the server's
+// gateway (EspNowReceiver::peekPending) and maps it into the server's
 // SensorReading type so it can be stored/forwarded in the same pipeline.
+// The gateway batches readings, so the body may be a single object or an
+// array of objects. An array is stored in one transaction: on failure
+// nothing is kept, so the gateway can spool and resend the whole batch
+// without duplicating readings. Each reading is then forwarded on its own.
 func handleGatewayJson(c echo.Context) error {
-	var payload map[string]any
-	if err := c.Bind(&payload); err != nil {
-		return c.JSON(http.StatusBadRequest, map[string]string{"error": "invalid gateway payload"})
+	body, err := io.ReadAll(c.Request().Body)
+	if err != nil {
+		return c.JSON(http.StatusBadRequest, map[string]string{"error": "failed to read request body"})
 	}
 
+	var payloads []map[string]any
+	trimmed := bytes.TrimSpace(body)
+	if len(trimmed) > 0 && trimmed[0] == '[' {
+		if err := json.Unmarshal(trimmed, &payloads); err != nil {
+			return c.JSON(http.StatusBadRequest, map[string]string{"error": "invalid gateway payload"})
+		}
+	} else {
+		var payload map[string]any
+		if err := json.Unmarshal(trimmed, &payload); err != nil {
+			return c.JSON(http.StatusBadRequest, map[string]string{"error": "invalid gateway payload"})
+		}
+		payloads = append(payloads, payload)
+	}
+
+	// Use remote address as a fallback gateway identifier
+	gatewayID := c.Request().RemoteAddr
+
+	url, urlErr := getEffectiveBrewfatherURL()
+	if urlErr != nil {
+		log.Printf("Failed to determine brewfather URL: %v", urlErr)
+	}
+
+	readings := make([]*SensorReading, 0, len(payloads))
+	for _, payload := range payloads {
+		readings = append(readings, gatewayPayloadToReading(payload, gatewayID))
+	}
+
+	if err := saveAllToDatabase(readings); err != nil {
+		log.Printf("Error saving gateway payload: %v", err)
+		return c.JSON(http.StatusInternalServerError, map[string]string{"status": "error", "error": "Failed to store metrics"})
+	}
+
+	for _, sr := range readings {
+		// Brewfather logs readings at arrival time, so replayed (backdated)
+		// readings would land in the wrong place on its chart; keep them local.
+		if urlErr == nil && url != "" && sr.Reading.Timestamp == 0 {
+			go func(sd *SensorReading) {
+				if err := forwardToBrewfather(sd); err != nil {
+					log.Printf("Failed to forward to Brewfather: %v", err)
+				}
+			}(sr)
+		}
+	}
+
+	return c.JSON(http.StatusOK, map[string]any{"status": "ok", "count": len(payloads)})
+}
+
+// gatewayPayloadToReading maps one gateway JSON object into a SensorReading.
+func gatewayPayloadToReading(payload map[string]any, gatewayID string) *SensorReading {
 	// Map fields with best-effort conversions.
 	reading := Reading{}
 	if v, ok := payload["gravity"]; ok {
@@ -577,6 +653,11 @@ func handleGatewayJson(c echo.Context) error {
 			reading.Interval = int(fi)
 		}
 	}
+	if v, ok := payload["timestamp"]; ok {
+		if fi, ok2 := v.(float64); ok2 && fi > 0 {
+			reading.Timestamp = int64(fi)
+		}
+	}
 
 	sensorId := "unknown"
 	if v, ok := payload["name"]; ok {
@@ -585,35 +666,14 @@ func handleGatewayJson(c echo.Context) error {
 		}
 	}
 
-	// Use remote address as a fallback gateway identifier
-	gatewayID := c.Request().RemoteAddr
-	gatewayName := gatewayID
-
 	sr := &SensorReading{
 		Reading:     reading,
 		GatewayID:   gatewayID,
-		GatewayName: gatewayName,
+		GatewayName: gatewayID,
 	}
 	// Use sensorID as the reading.SensorID
 	sr.Reading.SensorID = sensorId
-
-	// Save and optionally forward using existing logic
-	if err := saveToDatabase(sr); err != nil {
-		log.Printf("Error saving gateway payload: %v", err)
-		return c.JSON(http.StatusInternalServerError, map[string]string{"status": "error", "error": "Failed to store metrics"})
-	}
-
-	if url, err := getEffectiveBrewfatherURL(); err != nil {
-		log.Printf("Failed to determine brewfather URL: %v", err)
-	} else if url != "" {
-		go func(sd *SensorReading) {
-			if err := forwardToBrewfather(sd); err != nil {
-				log.Printf("Failed to forward to Brewfather: %v", err)
-			}
-		}(sr)
-	}
-
-	return c.JSON(http.StatusOK, map[string]string{"status": "ok"})
+	return sr
 }
 
 // forwardToBrewfather sends the incoming sensor reading JSON to the configured
@@ -0,0 +1,407 @@
+#pragma once
+
+// Compact (v2) encoding of readings packets. A sibling of the fixed 8-byte
+// TLV format in tilted_protocol.h, recognised by its own magic, for shorter
+// airtime with many sensors on one channel.
+//
+// Layout (all multi-byte fixed fields little-endian):
+//   uint16  magic = TILTED_COMPACT_MAGIC
+//   uint32  chipId
+//   varint  interval_s
+//   uint8   flags (TILTED_COMPACT_FLAG_*)
+//   [uint8 nameLen, name]       if FLAG_NAME; otherwise the receiver uses
+//                               what it last saw for this chipId
+//   [varint setCount]           if FLAG_BATCH; otherwise one set
+//   per set:
+//     [varint age_s]            if FLAG_BATCH (oldest set first)
+//     uint8   itemCount
+//     per item:
+//       uint8  type | ITEM_SCALE | ITEM_DELTA
+//       [int8  scale10]          if ITEM_SCALE; else the type's default scale
+//       zigzag varint value     delta against the previous set's item at the
+//                               same position if ITEM_DELTA
+//
+// Header-only and allocation-free, like the rest of shared/include.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tilted_packet_builder.h"
+#include "tilted_protocol.h"
+
+inline constexpr uint16_t TILTED_COMPACT_MAGIC = 0x5432; // 'T''2'
+
+inline constexpr uint8_t TILTED_COMPACT_FLAG_NAME = 0x01;
+inline constexpr uint8_t TILTED_COMPACT_FLAG_BATCH = 0x02;
+
+inline constexpr uint8_t TILTED_COMPACT_ITEM_SCALE = 0x80;
+inline constexpr uint8_t TILTED_COMPACT_ITEM_DELTA = 0x40;
+inline constexpr uint8_t TILTED_COMPACT_TYPE_MASK = 0x3F;
+
+// Most items a compact set may carry (bounds the decoder's delta state).
+inline constexpr uint8_t TILTED_COMPACT_MAX_ITEMS = 16;
+
+// The scale each type is normally sent with; items at this scale omit it.
+static inline int8_t tilted_default_scale10(uint8_t type)
+{
+    switch ((TiltedValueType)type)
+    {
+    case TiltedValueType::Tilt:
+    case TiltedValueType::Temp:
+    case TiltedValueType::AuxTemp:
+        return -1;
+    default:
+        return 0;
+    }
+}
+
+static inline uint32_t tilted_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t tilted_unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// ---------------------------------------------------------------- encoder
+
+struct TiltedCompactWriter
+{
+    uint8_t* buf;
+    uint16_t cap;
+    uint16_t len;
+    bool overflow;
+};
+
+static inline void tilted_compact_put(TiltedCompactWriter& w, const void* data, uint16_t n)
+{
+    if (w.overflow || (uint32_t)w.len + n > w.cap)
+    {
+        w.overflow = true;
+        return;
+    }
+    memcpy(w.buf + w.len, data, n);
+    w.len += n;
+}
+
+static inline void tilted_compact_put_u8(TiltedCompactWriter& w, uint8_t v)
+{
+    tilted_compact_put(w, &v, 1);
+}
+
+static inline void tilted_compact_put_varint(TiltedCompactWriter& w, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        tilted_compact_put_u8(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    tilted_compact_put_u8(w, (uint8_t)v);
+}
+
+// items/itemCount of one set; prev is the previous set (nullptr for the first).
+static inline void tilted_compact_put_set(
+    TiltedCompactWriter& w,
+    const TiltedValueItem* items,
+    uint8_t itemCount,
+    const TiltedValueItem* prev,
+    uint8_t prevCount)
+{
+    if (itemCount > TILTED_COMPACT_MAX_ITEMS || (!items && itemCount != 0))
+    {
+        w.overflow = true;
+        return;
+    }
+
+    tilted_compact_put_u8(w, itemCount);
+    for (uint8_t i = 0; i < itemCount; i++)
+    {
+        const TiltedValueItem& it = items[i];
+        if (it.type > TILTED_COMPACT_TYPE_MASK)
+        {
+            w.overflow = true;
+            return;
+        }
+
+        const bool explicitScale = it.scale10 != tilted_default_scale10(it.type);
+        const bool delta = prev && i < prevCount && prev[i].type == it.type && prev[i].scale10 == it.scale10;
+
+        uint8_t tag = it.type;
+        if (explicitScale)
+            tag |= TILTED_COMPACT_ITEM_SCALE;
+        if (delta)
+            tag |= TILTED_COMPACT_ITEM_DELTA;
+        tilted_compact_put_u8(w, tag);
+        if (explicitScale)
+            tilted_compact_put_u8(w, (uint8_t)it.scale10);
+
+        const int32_t v = delta ? (int32_t)((uint32_t)it.value - (uint32_t)prev[i].value) : it.value;
+        tilted_compact_put_varint(w, tilted_zigzag(v));
+    }
+}
+
+// Writes the fixed header, the optional name and, for batches, the set count.
+static inline void tilted_compact_put_header(
+    TiltedCompactWriter& w,
+    uint32_t chipId,
+    uint16_t intervalSeconds,
+    const char* name,
+    uint8_t nameLen,
+    uint8_t setCount)
+{
+    const bool withName = name && nameLen > 0;
+    if (nameLen > TILTED_MAX_NAME_LEN || setCount == 0)
+    {
+        w.overflow = true;
+        return;
+    }
+
+    uint8_t flags = 0;
+    if (withName)
+        flags |= TILTED_COMPACT_FLAG_NAME;
+    if (setCount > 1)
+        flags |= TILTED_COMPACT_FLAG_BATCH;
+
+    const uint16_t magic = TILTED_COMPACT_MAGIC;
+    tilted_compact_put(w, &magic, sizeof(magic));
+    tilted_compact_put(w, &chipId, sizeof(chipId));
+    tilted_compact_put_varint(w, intervalSeconds);
+    tilted_compact_put_u8(w, flags);
+    if (withName)
+    {
+        tilted_compact_put_u8(w, nameLen);
+        tilted_compact_put(w, name, nameLen);
+    }
+    if (setCount > 1)
+        tilted_compact_put_varint(w, setCount);
+}
+
+// Encodes one reading. Pass name = nullptr to leave it out.
+// Returns packet length on success, 0 on failure.
+static inline uint16_t tilted_encode_compact_packet(
+    uint8_t* outBuf,
+    uint16_t outBufMax,
+    uint32_t chipId,
+    uint16_t intervalSeconds,
+    const char* name,
+    uint8_t nameLen,
+    const TiltedValueItem* items,
+    uint8_t itemCount)
+{
+    TiltedCompactWriter w{outBuf, outBufMax, 0, outBuf == nullptr};
+    tilted_compact_put_header(w, chipId, intervalSeconds, name, nameLen, 1);
+    tilted_compact_put_set(w, items, itemCount, nullptr, 0);
+    return w.overflow ? 0 : w.len;
+}
+
+// Encodes several readings (oldest first), like tilted_encode_batch_packet().
+// A single set is encoded exactly like tilted_encode_compact_packet().
+// Returns packet length on success, 0 on failure.
+static inline uint16_t tilted_encode_compact_batch(
+    uint8_t* outBuf,
+    uint16_t outBufMax,
+    uint32_t chipId,
+    uint16_t intervalSeconds,
+    const char* name,
+    uint8_t nameLen,
+    const TiltedBatchSet* sets,
+    uint8_t setCount)
+{
+    TiltedCompactWriter w{outBuf, outBufMax, 0, outBuf == nullptr};
+    if (!sets)
+        return 0;
+
+    tilted_compact_put_header(w, chipId, intervalSeconds, name, nameLen, setCount);
+    for (uint8_t s = 0; s < setCount; s++)
+    {
+        if (setCount > 1)
+            tilted_compact_put_varint(w, sets[s].ageS);
+        tilted_compact_put_set(
+            w, sets[s].items, sets[s].itemCount,
+            s ? sets[s - 1].items : nullptr, s ? sets[s - 1].itemCount : 0);
+    }
+    return w.overflow ? 0 : w.len;
+}
+
+// ---------------------------------------------------------------- decoder
+
+struct TiltedCompactView
+{
+    uint32_t chipId;
+    uint16_t intervalS;
+    const char* name; // nullptr if the packet carries no name
+    uint8_t nameLen;
+    uint8_t setCount;
+    bool batch;
+    const uint8_t* sets;
+    uint16_t setsLen;
+};
+
+// Iteration state; keeps the previous set for delta decoding.
+struct TiltedCompactCursor
+{
+    uint16_t offset;
+    uint8_t index;
+    uint8_t prevCount;
+    TiltedValueItem prev[TILTED_COMPACT_MAX_ITEMS];
+};
+
+struct TiltedCompactReader
+{
+    const uint8_t* buf;
+    uint16_t len;
+    uint16_t pos;
+    bool bad;
+};
+
+static inline uint8_t tilted_compact_get_u8(TiltedCompactReader& r)
+{
+    if (r.bad || r.pos >= r.len)
+    {
+        r.bad = true;
+        return 0;
+    }
+    return r.buf[r.pos++];
+}
+
+static inline uint32_t tilted_compact_get_varint(TiltedCompactReader& r)
+{
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        const uint8_t b = tilted_compact_get_u8(r);
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    r.bad = true; // more than 5 bytes
+    return 0;
+}
+
+// Reads one set. items needs TILTED_COMPACT_MAX_ITEMS entries.
+static inline bool tilted_compact_get_set(
+    TiltedCompactReader& r,
+    bool batch,
+    uint32_t& ageS,
+    TiltedValueItem* items,
+    uint8_t& itemCount,
+    const TiltedValueItem* prev,
+    uint8_t prevCount)
+{
+    ageS = batch ? tilted_compact_get_varint(r) : 0;
+    itemCount = tilted_compact_get_u8(r);
+    if (r.bad || itemCount > TILTED_COMPACT_MAX_ITEMS)
+        return false;
+
+    for (uint8_t i = 0; i < itemCount; i++)
+    {
+        const uint8_t tag = tilted_compact_get_u8(r);
+        TiltedValueItem it{};
+        it.type = tag & TILTED_COMPACT_TYPE_MASK;
+        it.scale10 = (tag & TILTED_COMPACT_ITEM_SCALE) ? (int8_t)tilted_compact_get_u8(r)
+                                                       : tilted_default_scale10(it.type);
+        int32_t v = tilted_unzigzag(tilted_compact_get_varint(r));
+        if (tag & TILTED_COMPACT_ITEM_DELTA)
+        {
+            if (!prev || i >= prevCount)
+                return false;
+            v = (int32_t)((uint32_t)prev[i].value + (uint32_t)v);
+        }
+        it.value = v;
+        items[i] = it;
+    }
+    return !r.bad;
+}
+
+// Validates a compact packet, including every set, and returns pointers
+// into buf.
+static inline bool tilted_decode_compact_view(const uint8_t* buf, uint16_t len, TiltedCompactView& out)
+{
+    if (!buf || len < 2 + 4)
+        return false;
+
+    uint16_t magic;
+    memcpy(&magic, buf, sizeof(magic));
+    if (magic != TILTED_COMPACT_MAGIC)
+        return false;
+
+    TiltedCompactReader r{buf, len, 2, false};
+    TiltedCompactView v{};
+    memcpy(&v.chipId, buf + r.pos, sizeof(v.chipId));
+    r.pos += sizeof(v.chipId);
+
+    const uint32_t interval = tilted_compact_get_varint(r);
+    const uint8_t flags = tilted_compact_get_u8(r);
+    if (r.bad || interval > 0xFFFF)
+        return false;
+    v.intervalS = (uint16_t)interval;
+
+    if (flags & TILTED_COMPACT_FLAG_NAME)
+    {
+        v.nameLen = tilted_compact_get_u8(r);
+        if (r.bad || v.nameLen > TILTED_MAX_NAME_LEN || (uint32_t)r.pos + v.nameLen > len)
+            return false;
+        v.name = reinterpret_cast<const char*>(buf + r.pos);
+        r.pos += v.nameLen;
+    }
+
+    v.batch = (flags & TILTED_COMPACT_FLAG_BATCH) != 0;
+    uint32_t sets = 1;
+    if (v.batch)
+        sets = tilted_compact_get_varint(r);
+    if (r.bad || sets == 0 || sets > 0xFF)
+        return false;
+    v.setCount = (uint8_t)sets;
+    v.sets = buf + r.pos;
+    v.setsLen = len - r.pos;
+
+    // Walk every set so a truncated or padded frame is rejected up front.
+    TiltedValueItem a[TILTED_COMPACT_MAX_ITEMS];
+    TiltedValueItem b[TILTED_COMPACT_MAX_ITEMS];
+    TiltedValueItem* cur = a;
+    TiltedValueItem* prev = b;
+    uint8_t prevCount = 0;
+    for (uint8_t s = 0; s < v.setCount; s++)
+    {
+        uint32_t age;
+        uint8_t count;
+        if (!tilted_compact_get_set(r, v.batch, age, cur, count, s ? prev : nullptr, prevCount))
+            return false;
+        TiltedValueItem* t = prev;
+        prev = cur;
+        cur = t;
+        prevCount = count;
+    }
+    if (r.pos != len)
+        return false;
+
+    out = v;
+    return true;
+}
+
+// Iterates the sets of a decoded compact packet. Zero-initialise the cursor
+// first; returns false after the last set. items needs TILTED_COMPACT_MAX_ITEMS
+// entries.
+static inline bool tilted_compact_next_set(
+    const TiltedCompactView& view,
+    TiltedCompactCursor& cursor,
+    uint32_t& ageS,
+    TiltedValueItem* items,
+    uint8_t& itemCount)
+{
+    if (cursor.index >= view.setCount)
+        return false;
+
+    TiltedCompactReader r{view.sets, view.setsLen, cursor.offset, false};
+    if (!tilted_compact_get_set(r, view.batch, ageS, items, itemCount,
+                                cursor.index ? cursor.prev : nullptr, cursor.prevCount))
+        return false;
+
+    cursor.offset = r.pos;
+    cursor.index++;
+    cursor.prevCount = itemCount;
+    memcpy(cursor.prev, items, (size_t)itemCount * sizeof(TiltedValueItem));
+    return true;
+}
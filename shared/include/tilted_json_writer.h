@@ -0,0 +1,232 @@
+#pragma once
+
+// Write a Brewfather/Tilted-server JSON payload straight from a decoded
+// readings packet into a caller-provided buffer.
+// No heap allocations and no float formatting: TLV values are already
+// fixed-point (value * 10^scale10), so they are printed digit by digit.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tilted_protocol.h"
+
+// Append-only writer over a fixed buffer. Once anything fails to fit,
+// overflow is set and further writes are ignored.
+struct TiltedJsonWriter
+{
+    char* buf;
+    uint16_t cap;
+    uint16_t len;
+    bool overflow;
+    bool needComma;
+};
+
+static inline void tilted_json_init(TiltedJsonWriter& w, char* buf, uint16_t cap)
+{
+    w.buf = buf;
+    w.cap = cap;
+    w.len = 0;
+    w.overflow = (buf == nullptr || cap == 0);
+    w.needComma = false;
+}
+
+static inline void tilted_json_put(TiltedJsonWriter& w, const char* s, uint16_t n)
+{
+    if (w.overflow)
+        return;
+    if ((uint32_t)w.len + n > w.cap)
+    {
+        w.overflow = true;
+        return;
+    }
+    memcpy(w.buf + w.len, s, n);
+    w.len += n;
+}
+
+static inline void tilted_json_putc(TiltedJsonWriter& w, char c)
+{
+    tilted_json_put(w, &c, 1);
+}
+
+// Quoted string with the escapes JSON requires.
+static inline void tilted_json_string(TiltedJsonWriter& w, const char* s, uint16_t n)
+{
+    static const char hex[] = "0123456789abcdef";
+    tilted_json_putc(w, '"');
+    for (uint16_t i = 0; i < n; i++)
+    {
+        const unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\')
+        {
+            const char esc[2] = {'\\', (char)c};
+            tilted_json_put(w, esc, 2);
+        }
+        else if (c < 0x20)
+        {
+            const char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            tilted_json_put(w, esc, 6);
+        }
+        else
+        {
+            tilted_json_putc(w, (char)c);
+        }
+    }
+    tilted_json_putc(w, '"');
+}
+
+// Starts a member: writes the separator and "key":
+static inline void tilted_json_key(TiltedJsonWriter& w, const char* key)
+{
+    if (w.needComma)
+        tilted_json_putc(w, ',');
+    tilted_json_string(w, key, (uint16_t)strlen(key));
+    tilted_json_putc(w, ':');
+    w.needComma = true;
+}
+
+// Prints mantissa * 10^scale10 exactly, e.g. (234, -1) => 23.4, (3310, -3) => 3.310.
+static inline void tilted_json_fixed(TiltedJsonWriter& w, int32_t mantissa, int8_t scale10)
+{
+    char digits[12];
+    uint8_t n = 0;
+    uint32_t mag = (mantissa < 0) ? (uint32_t)0 - (uint32_t)mantissa : (uint32_t)mantissa;
+    do
+    {
+        digits[n++] = (char)('0' + (mag % 10));
+        mag /= 10;
+    } while (mag != 0);
+
+    if (mantissa < 0)
+        tilted_json_putc(w, '-');
+
+    if (scale10 >= 0)
+    {
+        while (n > 0)
+            tilted_json_putc(w, digits[--n]);
+        for (int8_t i = 0; i < scale10; i++)
+            tilted_json_putc(w, '0');
+        return;
+    }
+
+    const uint8_t frac = (uint8_t)(-scale10);
+    if (n <= frac)
+    {
+        tilted_json_putc(w, '0');
+    }
+    else
+    {
+        while (n > frac)
+            tilted_json_putc(w, digits[--n]);
+    }
+    tilted_json_putc(w, '.');
+    for (uint8_t i = frac; i > 0; i--)
+        tilted_json_putc(w, (i <= n) ? digits[i - 1] : '0');
+}
+
+static inline void tilted_json_begin_object(TiltedJsonWriter& w)
+{
+    tilted_json_putc(w, '{');
+    w.needComma = false;
+}
+
+static inline void tilted_json_end_object(TiltedJsonWriter& w)
+{
+    tilted_json_putc(w, '}');
+    w.needComma = true;
+}
+
+// How each TiltedValueType is written, indexed by type. key = nullptr: not
+// written. unitKey, if set, is followed by "C". scaleShift converts units.
+struct TiltedJsonField
+{
+    const char* key;
+    const char* unitKey;
+    int8_t scaleShift;
+};
+
+inline constexpr TiltedJsonField TILTED_JSON_FIELDS[] = {
+    {nullptr, nullptr, 0},             // 0: unused
+    {"angle", nullptr, 0},             // Tilt
+    {"temp", "temp_unit", 0},          // Temp
+    {"aux_temp", "aux_temp_unit", 0},  // AuxTemp
+    {"battery", nullptr, -3},          // BatteryMv; Brewfather expects volts
+    {"interval", nullptr, 0},          // IntervalS
+    {"rssi", nullptr, 0},              // RssiDbm
+    {"samples", nullptr, 0},           // SampleCount
+    {"tx_retries", nullptr, 0},        // TxRetries
+    {"seq", nullptr, 0},               // Sequence
+    {"awake_ms", nullptr, 0},          // AwakeMs
+    {"radio_ms", nullptr, 0},          // RadioMs
+    {"reset_reason", nullptr, 0},      // ResetReason
+    {"heartbeat", nullptr, 0},         // HeartbeatS
+    {"config_version", nullptr, 0},    // ConfigVersion
+    {nullptr, nullptr, 0},             // TiltDeadband: config frames only
+    {nullptr, nullptr, 0},             // TempDeadband: config frames only
+};
+inline constexpr uint8_t TILTED_JSON_FIELD_COUNT = sizeof(TILTED_JSON_FIELDS) / sizeof(TILTED_JSON_FIELDS[0]);
+static_assert(TILTED_JSON_FIELD_COUNT == (uint8_t)TiltedValueType::TempDeadband + 1,
+              "TILTED_JSON_FIELDS needs an entry for every TiltedValueType");
+
+// Writes the members of one reading's JSON payload into an open object:
+//   "name":..,"angle":..,"temp":..,"temp_unit":"C",..,"gravity":..,"gravity_unit":"G"
+// gravity5 is the gravity scaled by 10^5 (pass includeGravity=false if unknown).
+// Callers can add their own members before closing the object.
+static inline void tilted_json_readings_members(
+    TiltedJsonWriter& w,
+    const TiltedReadingsView& view,
+    bool includeGravity,
+    int32_t gravity5)
+{
+    if (!view.name || (!view.items && view.header.itemCount != 0))
+    {
+        w.overflow = true;
+        return;
+    }
+
+    uint8_t nlen = view.header.nameLen;
+    if (nlen > TILTED_MAX_NAME_LEN)
+        nlen = TILTED_MAX_NAME_LEN;
+    tilted_json_key(w, "name");
+    tilted_json_string(w, view.name, nlen);
+
+    for (const TiltedValueItem it : tilted_items(view))
+    {
+        if (it.type >= TILTED_JSON_FIELD_COUNT)
+            continue;
+        const TiltedJsonField& f = TILTED_JSON_FIELDS[it.type];
+        if (!f.key)
+            continue;
+        tilted_json_key(w, f.key);
+        tilted_json_fixed(w, it.value, (int8_t)(it.scale10 + f.scaleShift));
+        if (f.unitKey)
+        {
+            tilted_json_key(w, f.unitKey);
+            tilted_json_put(w, "\"C\"", 3);
+        }
+    }
+
+    if (includeGravity)
+    {
+        tilted_json_key(w, "gravity");
+        tilted_json_fixed(w, gravity5, -5);
+        tilted_json_key(w, "gravity_unit");
+        tilted_json_put(w, "\"G\"", 3);
+    }
+}
+
+// Encodes one reading as the gateway's JSON payload object.
+// Returns bytes written (not null-terminated), 0 if it did not fit.
+static inline uint16_t tilted_encode_readings_json(
+    char* out,
+    uint16_t outMax,
+    const TiltedReadingsView& view,
+    bool includeGravity,
+    int32_t gravity5)
+{
+    TiltedJsonWriter w;
+    tilted_json_init(w, out, outMax);
+    tilted_json_begin_object(w);
+    tilted_json_readings_members(w, view, includeGravity, gravity5);
+    tilted_json_end_object(w);
+    return w.overflow ? 0 : w.len;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+// Compile-time leveled logging for both firmwares.
+//
+// Messages are formatted into a RAM ring buffer instead of going straight to
+// Serial, so hot paths never wait on the UART (74880 baud on the sensor is
+// ~130 us per character once its FIFO is full). Call tilted_log_flush() where
+// blocking is harmless: right before deep sleep on the sensor, from the idle
+// part of loop() on the gateway.
+//
+// Levels (TILTED_LOG_LEVEL, e.g. -DTILTED_LOG_LEVEL=3):
+//   0 none   - every macro compiles out, arguments are not evaluated
+//   1 error
+//   2 info   (default)
+//   3 debug  - per-reading detail
+//
+// A full buffer drops new messages; the next flush reports how many.
+//
+// Usage:
+//   TILTED_LOGI("Radio up in %lu ms\n", ms);
+//   TILTED_LOGD("tilt=%.3f\n", tilt);
+//   tilted_log_flush();
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TILTED_LOG_NONE 0
+#define TILTED_LOG_ERROR 1
+#define TILTED_LOG_INFO 2
+#define TILTED_LOG_DEBUG 3
+
+#ifndef TILTED_LOG_LEVEL
+#define TILTED_LOG_LEVEL TILTED_LOG_INFO
+#endif
+
+// Ring size; must be a power of two.
+#ifndef TILTED_LOG_BUFFER_BYTES
+#define TILTED_LOG_BUFFER_BYTES 2048
+#endif
+
+// Longest single message; longer ones are truncated.
+#define TILTED_LOG_LINE_MAX 192
+
+#if TILTED_LOG_LEVEL > TILTED_LOG_NONE
+
+static_assert((TILTED_LOG_BUFFER_BYTES & (TILTED_LOG_BUFFER_BYTES - 1)) == 0,
+              "TILTED_LOG_BUFFER_BYTES must be a power of two");
+
+struct TiltedLogRing
+{
+    char buf[TILTED_LOG_BUFFER_BYTES];
+    uint32_t head; // free-running write index
+    uint32_t tail; // free-running read index
+    uint32_t dropped;
+};
+
+// inline: one ring for the whole firmware, however many files log.
+inline TiltedLogRing tilted_log_ring{};
+
+#if defined(ESP32)
+// The gateway logs from loop() and the ESP-NOW worker.
+inline portMUX_TYPE tilted_log_mux = portMUX_INITIALIZER_UNLOCKED;
+#define TILTED_LOG_LOCK() portENTER_CRITICAL(&tilted_log_mux)
+#define TILTED_LOG_UNLOCK() portEXIT_CRITICAL(&tilted_log_mux)
+#else
+#define TILTED_LOG_LOCK() do { } while (0)
+#define TILTED_LOG_UNLOCK() do { } while (0)
+#endif
+
+// Appends len bytes, or drops the whole message if it does not fit.
+static inline void tilted_log_write(const char* data, size_t len)
+{
+    if (!data || len == 0)
+        return;
+
+    TILTED_LOG_LOCK();
+    TiltedLogRing& r = tilted_log_ring;
+    if (len > TILTED_LOG_BUFFER_BYTES - (r.head - r.tail))
+    {
+        r.dropped++;
+    }
+    else
+    {
+        const uint32_t at = r.head & (TILTED_LOG_BUFFER_BYTES - 1);
+        const size_t first = (len < TILTED_LOG_BUFFER_BYTES - at) ? len : TILTED_LOG_BUFFER_BYTES - at;
+        memcpy(r.buf + at, data, first);
+        memcpy(r.buf, data + first, len - first);
+        r.head += len;
+    }
+    TILTED_LOG_UNLOCK();
+}
+
+static inline void tilted_log_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void tilted_log_printf(const char* fmt, ...)
+{
+    // Formatted outside the lock.
+    char line[TILTED_LOG_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0)
+        return;
+    if (n >= (int)sizeof(line))
+        n = sizeof(line) - 1;
+    tilted_log_write(line, (size_t)n);
+}
+
+// Writes everything buffered to Serial and waits for the UART to drain.
+// Copies out in chunks so writers are only held off for a memcpy.
+static inline void tilted_log_flush()
+{
+    char chunk[128];
+    uint32_t dropped = 0;
+    for (;;)
+    {
+        TILTED_LOG_LOCK();
+        TiltedLogRing& r = tilted_log_ring;
+        const uint32_t at = r.tail & (TILTED_LOG_BUFFER_BYTES - 1);
+        uint32_t n = r.head - r.tail;
+        if (n > sizeof(chunk))
+            n = sizeof(chunk);
+        if (n > TILTED_LOG_BUFFER_BYTES - at)
+            n = TILTED_LOG_BUFFER_BYTES - at;
+        memcpy(chunk, r.buf + at, n);
+        r.tail += n;
+        if (n == 0)
+        {
+            dropped = r.dropped;
+            r.dropped = 0;
+        }
+        TILTED_LOG_UNLOCK();
+
+        if (n == 0)
+            break;
+        Serial.write(reinterpret_cast<const uint8_t*>(chunk), n);
+    }
+    if (dropped)
+        Serial.printf("[log] %lu message(s) dropped\n", (unsigned long)dropped);
+    Serial.flush();
+}
+
+#else
+
+static inline void tilted_log_flush() {}
+
+#endif
+
+#if TILTED_LOG_LEVEL >= TILTED_LOG_ERROR
+#define TILTED_LOGE(...) tilted_log_printf(__VA_ARGS__)
+#else
+#define TILTED_LOGE(...) do { } while (0)
+#endif
+
+#if TILTED_LOG_LEVEL >= TILTED_LOG_INFO
+#define TILTED_LOGI(...) tilted_log_printf(__VA_ARGS__)
+#else
+#define TILTED_LOGI(...) do { } while (0)
+#endif
+
+#if TILTED_LOG_LEVEL >= TILTED_LOG_DEBUG
+#define TILTED_LOGD(...) tilted_log_printf(__VA_ARGS__)
+// Raw bytes (e.g. a JSON body longer than TILTED_LOG_LINE_MAX).
+#define TILTED_LOGD_DATA(data, len) tilted_log_write((data), (len))
+#else
+#define TILTED_LOGD(...) do { } while (0)
+#define TILTED_LOGD_DATA(data, len) do { } while (0)
+#endif
@@ -3,6 +3,7 @@
 // Build TLV readings packets into a caller-provided buffer.
 // No heap allocations; safe for MCUs.
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -48,3 +49,125 @@ static inline uint16_t tilted_encode_readings_packet(
 
     return pktLen;
 }
+
+// Appends one item to an encoded readings packet in place (the receiver
+// adding what only it can measure, such as RSSI).
+// Returns the new packet length, 0 if buf is not a readings packet or the
+// item does not fit.
+static inline uint16_t tilted_append_readings_item(uint8_t* buf, uint16_t len, uint16_t bufMax, const TiltedValueItem& item)
+{
+    TiltedReadingsView view{};
+    if (!tilted_decode_readings_view(buf, len, view) || view.header.itemCount == 0xFF ||
+        (uint32_t)len + sizeof(TiltedValueItem) > bufMax)
+        return 0;
+
+    const uint8_t itemCount = view.header.itemCount + 1;
+    memcpy(buf + offsetof(TiltedReadingsHeader, itemCount), &itemCount, sizeof(itemCount));
+    memcpy(buf + len, &item, sizeof(item));
+    return (uint16_t)(len + sizeof(item));
+}
+
+// One set of a batch packet (see TiltedBatchSetHeader).
+struct TiltedBatchSet
+{
+    uint32_t ageS;
+    const TiltedValueItem* items;
+    uint8_t itemCount;
+};
+
+// Size of a batch packet, or 0 if invalid/unrepresentable.
+static inline uint16_t tilted_batch_packet_size(uint8_t nameLen, const TiltedBatchSet* sets, uint8_t setCount)
+{
+    if (nameLen > TILTED_MAX_NAME_LEN || !sets || setCount == 0)
+        return 0;
+
+    uint32_t sz = sizeof(TiltedReadingsHeader) + nameLen;
+    for (uint8_t i = 0; i < setCount; i++)
+        sz += sizeof(TiltedBatchSetHeader) + (uint32_t)sets[i].itemCount * sizeof(TiltedValueItem);
+    if (sz > 0xFFFF)
+        return 0;
+    return (uint16_t)sz;
+}
+
+// Encodes a batch packet (sets oldest first) into outBuf.
+// Returns packet length on success, 0 on failure.
+static inline uint16_t tilted_encode_batch_packet(
+    uint8_t* outBuf,
+    uint16_t outBufMax,
+    uint32_t chipId,
+    uint16_t intervalSeconds,
+    const char* name,
+    uint8_t nameLen,
+    const TiltedBatchSet* sets,
+    uint8_t setCount)
+{
+    if (!outBuf || !name)
+        return 0;
+
+    uint16_t pktLen = tilted_batch_packet_size(nameLen, sets, setCount);
+    if (pktLen == 0 || pktLen > outBufMax)
+        return 0;
+
+    TiltedReadingsHeader hdr;
+    hdr.magic = TILTED_BATCH_MAGIC;
+    hdr.chipId = chipId;
+    hdr.interval_s = intervalSeconds;
+    hdr.nameLen = nameLen;
+    hdr.itemCount = setCount;
+
+    uint8_t* p = outBuf;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, name, nameLen);
+    p += nameLen;
+    for (uint8_t i = 0; i < setCount; i++)
+    {
+        if (!sets[i].items && sets[i].itemCount != 0)
+            return 0;
+
+        TiltedBatchSetHeader set;
+        set.age_s = sets[i].ageS;
+        set.itemCount = sets[i].itemCount;
+        memcpy(p, &set, sizeof(set));
+        p += sizeof(set);
+        if (set.itemCount)
+        {
+            memcpy(p, sets[i].items, (size_t)set.itemCount * sizeof(TiltedValueItem));
+            p += (size_t)set.itemCount * sizeof(TiltedValueItem);
+        }
+    }
+
+    return pktLen;
+}
+
+// Encodes a config downlink packet (see TiltedConfigHeader) into outBuf.
+// Returns packet length on success, 0 on failure.
+static inline uint16_t tilted_encode_config_packet(
+    uint8_t* outBuf,
+    uint16_t outBufMax,
+    uint32_t chipId,
+    uint16_t version,
+    const TiltedValueItem* items,
+    uint8_t itemCount)
+{
+    if (!outBuf || (!items && itemCount != 0) || itemCount > TILTED_MAX_CONFIG_ITEMS)
+        return 0;
+
+    const uint16_t pktLen = sizeof(TiltedConfigHeader) + (uint16_t)itemCount * sizeof(TiltedValueItem);
+    if (pktLen > outBufMax)
+        return 0;
+
+    TiltedConfigHeader hdr;
+    hdr.magic = TILTED_CONFIG_MAGIC;
+    hdr.chipId = chipId;
+    hdr.version = version;
+    hdr.itemCount = itemCount;
+
+    memcpy(outBuf, &hdr, sizeof(hdr));
+    if (itemCount)
+    {
+        memcpy(outBuf + sizeof(hdr), items, (size_t)itemCount * sizeof(TiltedValueItem));
+    }
+
+    return pktLen;
+}
@@ -4,8 +4,11 @@
 // Keep this header Arduino-friendly and avoid heavy includes.
 
 #include <stdint.h>
+#include <string.h>
 
 // ESP-NOW settings (must match on sender/receiver)
+// Default channel. A gateway that keeps WiFi connected uses its AP's channel
+// instead; sensors then learn it by sweeping and keep it in RTC memory.
 inline constexpr uint8_t TILTED_ESPNOW_CHANNEL = 1;
 
 // Receiver (gateway) MAC address used by the sensor when adding a peer.
@@ -26,11 +29,29 @@ enum class TiltedValueType : uint8_t
     BatteryMv = 4,
     IntervalS = 5,
     RssiDbm = 6,
+    SampleCount = 7, // tilt samples behind the reported angle
+    TxRetries = 8,   // resends before this frame was ACKed
+    Sequence = 9,    // per-sensor reading number, from 1 after power-on
+    // Wake-cycle telemetry, for tuning intervals and spotting battery drain.
+    AwakeMs = 10,     // previous wake, boot to deep sleep
+    RadioMs = 11,     // previous wake, radio on (0 = stayed off)
+    ResetReason = 12, // this wake's reset cause (ESP8266 rst_info::reason)
+    HeartbeatS = 13,  // longest the sensor stays silent while readings are unchanged
+    // Settings downlink (see TiltedConfigHeader).
+    ConfigVersion = 14, // uplink: settings version applied; asks for a config frame
+    TiltDeadband = 15,  // config: deg, changes below this count as unchanged
+    TempDeadband = 16,  // config: C, likewise
 };
 
 // Magic chosen to help quickly reject garbage packets.
 inline constexpr uint16_t TILTED_MAGIC = 0x544C; // 'T''L'
 
+// Batch packets: several timestamped readings from one sensor in one frame.
+inline constexpr uint16_t TILTED_BATCH_MAGIC = 0x5442; // 'T''B'
+
+// ESP-NOW payload limit (ESP_NOW_MAX_DATA_LEN on both chips).
+inline constexpr uint16_t TILTED_MAX_FRAME_LEN = 250;
+
 // Maximum name bytes we will encode on the wire.
 // Suggested name format: "tilt-" + HEX_CHIP_ID (e.g. "tilt-1a2b3c4d").
 inline constexpr uint8_t TILTED_MAX_NAME_LEN = 24;
@@ -58,8 +79,88 @@ struct __attribute__((packed)) TiltedValueItem
     int32_t value;
 };
 
+// Batch packet layout:
+//   TiltedReadingsHeader (magic = TILTED_BATCH_MAGIC, itemCount = number of sets)
+//   name
+//   per set: TiltedBatchSetHeader, then itemCount TiltedValueItems
+// Sets are oldest first; age_s is how long before sending the set was taken.
+struct __attribute__((packed)) TiltedBatchSetHeader
+{
+    uint32_t age_s;
+    uint8_t itemCount;
+};
+
+// Config downlink: the gateway's reply to an uplink that carries a
+// ConfigVersion item, sent straight back to the sensor's MAC.
+// Layout: TiltedConfigHeader, then itemCount TiltedValueItems (IntervalS,
+// SampleCount, TiltDeadband, TempDeadband). A setting left out reverts to
+// the sensor's built-in default. version = 0 means no settings. A sensor
+// whose version is current gets no reply.
+inline constexpr uint16_t TILTED_CONFIG_MAGIC = 0x5443; // 'T''C'
+inline constexpr uint8_t TILTED_MAX_CONFIG_ITEMS = 8;
+
+struct __attribute__((packed)) TiltedConfigHeader
+{
+    uint16_t magic;   // TILTED_CONFIG_MAGIC
+    uint32_t chipId;  // addressee
+    uint16_t version; // of these settings, never 0 when items follow
+    uint8_t itemCount;
+};
+
 static_assert(sizeof(TiltedReadingsHeader) == 10, "Unexpected TiltedReadingsHeader size");
 static_assert(sizeof(TiltedValueItem) == 8, "Unexpected TiltedValueItem size");
+static_assert(sizeof(TiltedBatchSetHeader) == 5, "Unexpected TiltedBatchSetHeader size");
+static_assert(sizeof(TiltedConfigHeader) == 9, "Unexpected TiltedConfigHeader size");
+
+// Loads the item at p (any alignment). Goes through memcpy rather than a
+// TiltedValueItem* so no code path depends on the packed attribute.
+static inline TiltedValueItem tilted_load_item(const uint8_t* p)
+{
+    TiltedValueItem it;
+    memcpy(&it, p, sizeof(it));
+    return it;
+}
+
+// Loads a wire header (TiltedReadingsHeader, TiltedBatchSetHeader,
+// TiltedConfigHeader) at p, any alignment, the same way.
+template <typename Header>
+static inline Header tilted_load_header(const uint8_t* p)
+{
+    Header h;
+    memcpy(&h, p, sizeof(h));
+    return h;
+}
+
+// Typed iteration over the items of a decoded packet or batch set:
+//   for (const TiltedValueItem it : tilted_items(view)) { ... }
+// Yields copies, so items can be used freely whatever the buffer alignment.
+struct TiltedItemRange
+{
+    struct Iterator
+    {
+        const uint8_t* p;
+
+        TiltedValueItem operator*() const { return tilted_load_item(p); }
+        Iterator& operator++()
+        {
+            p += sizeof(TiltedValueItem);
+            return *this;
+        }
+        bool operator!=(const Iterator& o) const { return p != o.p; }
+    };
+
+    const uint8_t* data;
+    uint8_t count;
+
+    Iterator begin() const { return Iterator{data}; }
+    Iterator end() const { return Iterator{data + (uint16_t)count * sizeof(TiltedValueItem)}; }
+    TiltedValueItem operator[](uint8_t i) const { return tilted_load_item(data + (uint16_t)i * sizeof(TiltedValueItem)); }
+};
+
+static inline TiltedItemRange tilted_items(const TiltedValueItem* items, uint8_t count)
+{
+    return TiltedItemRange{reinterpret_cast<const uint8_t*>(items), items ? count : (uint8_t)0};
+}
 
 // Compute total packet size (header + name + items). Returns 0 if invalid/unrepresentable.
 static inline uint16_t tilted_readings_packet_size(uint8_t nameLen, uint8_t itemCount)
@@ -75,10 +176,10 @@ static inline uint16_t tilted_readings_packet_size(uint8_t nameLen, uint8_t item
 }
 
 // Light-weight decoder helper: validates sizes and returns pointers into the provided buffer.
-// No allocations; caller owns the buffer.
+// No allocations; caller owns the buffer. The header is a copy, loaded like the items.
 struct TiltedReadingsView
 {
-    const TiltedReadingsHeader* header;
+    TiltedReadingsHeader header;
     const char* name;
     const TiltedValueItem* items;
 };
@@ -88,20 +189,125 @@ static inline bool tilted_decode_readings_view(const uint8_t* buf, uint16_t len,
     if (!buf || len < sizeof(TiltedReadingsHeader))
         return false;
 
-    auto hdr = reinterpret_cast<const TiltedReadingsHeader*>(buf);
-    if (hdr->magic != TILTED_MAGIC)
+    const auto hdr = tilted_load_header<TiltedReadingsHeader>(buf);
+    if (hdr.magic != TILTED_MAGIC)
         return false;
-    if (hdr->nameLen > TILTED_MAX_NAME_LEN)
+    if (hdr.nameLen > TILTED_MAX_NAME_LEN)
         return false;
 
-    uint16_t expected = tilted_readings_packet_size(hdr->nameLen, hdr->itemCount);
+    uint16_t expected = tilted_readings_packet_size(hdr.nameLen, hdr.itemCount);
     if (expected == 0 || len != expected)
         return false;
 
     const uint8_t* p = buf + sizeof(TiltedReadingsHeader);
     out.header = hdr;
     out.name = reinterpret_cast<const char*>(p);
-    p += hdr->nameLen;
+    p += hdr.nameLen;
     out.items = reinterpret_cast<const TiltedValueItem*>(p);
     return true;
 }
+
+static inline TiltedItemRange tilted_items(const TiltedReadingsView& view)
+{
+    return tilted_items(view.items, view.header.itemCount);
+}
+
+struct TiltedBatchView
+{
+    TiltedReadingsHeader header; // itemCount = number of sets
+    const char* name;
+    const uint8_t* sets;
+    uint16_t setsLen;
+};
+
+struct TiltedBatchSetView
+{
+    uint32_t ageS;
+    const TiltedValueItem* items;
+    uint8_t itemCount;
+};
+
+// Validates a batch packet, including every set, and returns pointers into buf.
+static inline bool tilted_decode_batch_view(const uint8_t* buf, uint16_t len, TiltedBatchView& out)
+{
+    if (!buf || len < sizeof(TiltedReadingsHeader))
+        return false;
+
+    const auto hdr = tilted_load_header<TiltedReadingsHeader>(buf);
+    if (hdr.magic != TILTED_BATCH_MAGIC)
+        return false;
+    if (hdr.nameLen > TILTED_MAX_NAME_LEN || hdr.itemCount == 0)
+        return false;
+
+    const uint16_t setsOffset = sizeof(TiltedReadingsHeader) + hdr.nameLen;
+    if (len < setsOffset)
+        return false;
+
+    // Walk the sets; they must exactly fill the rest of the packet.
+    uint16_t off = setsOffset;
+    for (uint8_t i = 0; i < hdr.itemCount; i++)
+    {
+        if ((uint32_t)off + sizeof(TiltedBatchSetHeader) > len)
+            return false;
+        const uint8_t items = tilted_load_header<TiltedBatchSetHeader>(buf + off).itemCount;
+        const uint32_t next = (uint32_t)off + sizeof(TiltedBatchSetHeader) + (uint32_t)items * sizeof(TiltedValueItem);
+        if (next > len)
+            return false;
+        off = (uint16_t)next;
+    }
+    if (off != len)
+        return false;
+
+    out.header = hdr;
+    out.name = reinterpret_cast<const char*>(buf + sizeof(TiltedReadingsHeader));
+    out.sets = buf + setsOffset;
+    out.setsLen = len - setsOffset;
+    return true;
+}
+
+// Iterates the sets of a decoded batch. Start with offset = 0; returns false
+// after the last set.
+static inline bool tilted_batch_next_set(const TiltedBatchView& view, uint16_t& offset, TiltedBatchSetView& out)
+{
+    if ((uint32_t)offset + sizeof(TiltedBatchSetHeader) > view.setsLen)
+        return false;
+
+    const auto set = tilted_load_header<TiltedBatchSetHeader>(view.sets + offset);
+    out.ageS = set.age_s;
+    out.itemCount = set.itemCount;
+    out.items = reinterpret_cast<const TiltedValueItem*>(view.sets + offset + sizeof(TiltedBatchSetHeader));
+    offset += sizeof(TiltedBatchSetHeader) + (uint16_t)set.itemCount * sizeof(TiltedValueItem);
+    return true;
+}
+
+static inline TiltedItemRange tilted_items(const TiltedBatchSetView& set)
+{
+    return tilted_items(set.items, set.itemCount);
+}
+
+struct TiltedConfigView
+{
+    TiltedConfigHeader header;
+    const TiltedValueItem* items;
+};
+
+static inline bool tilted_decode_config_view(const uint8_t* buf, uint16_t len, TiltedConfigView& out)
+{
+    if (!buf || len < sizeof(TiltedConfigHeader))
+        return false;
+
+    const auto hdr = tilted_load_header<TiltedConfigHeader>(buf);
+    if (hdr.magic != TILTED_CONFIG_MAGIC || hdr.itemCount > TILTED_MAX_CONFIG_ITEMS)
+        return false;
+    if (len != sizeof(TiltedConfigHeader) + (uint16_t)hdr.itemCount * sizeof(TiltedValueItem))
+        return false;
+
+    out.header = hdr;
+    out.items = reinterpret_cast<const TiltedValueItem*>(buf + sizeof(TiltedConfigHeader));
+    return true;
+}
+
+static inline TiltedItemRange tilted_items(const TiltedConfigView& view)
+{
+    return tilted_items(view.items, view.header.itemCount);
+}
@@ -3,6 +3,7 @@
 // Tiny helpers to build TiltedValueItem values consistently across projects.
 // Kept header-only and Arduino-friendly (no heap).
 
+#include <math.h>
 #include <stdint.h>
 
 #include "tilted_protocol.h"
@@ -11,29 +12,48 @@
 // or from a float with scaling/rounding.
 namespace TiltedValueHelper
 {
+    // 10^0 .. 10^38 (every power a float can hold), built at compile time.
+    static constexpr uint8_t POW10_MAX = 38;
+
+    struct Pow10Table
+    {
+        float v[POW10_MAX + 1];
+
+        constexpr Pow10Table() : v()
+        {
+            double p = 1.0;
+            for (uint8_t n = 0; n <= POW10_MAX; n++, p *= 10.0)
+                v[n] = (float)p;
+        }
+    };
+
+    inline constexpr Pow10Table pow10Table{};
+
+    // 10^n for n >= 0; infinity past the float range.
+    static inline float pow10f(int n)
+    {
+        return (n <= POW10_MAX) ? pow10Table.v[n] : INFINITY;
+    }
+
+    // value * 10^scale10 for any scale10. Negative exponents divide, which is
+    // exact where multiplying by 0.1f etc. is not.
+    static inline float applyScale(float value, int scale10)
+    {
+        return (scale10 >= 0) ? value * pow10f(scale10) : value / pow10f(-scale10);
+    }
+
+    // Real value of an item: value * 10^scale10.
+    static inline float toFloat(const TiltedValueItem& it)
+    {
+        return applyScale((float)it.value, it.scale10);
+    }
+
     // Round a float to an integer with base-10 scaling.
     // Example: scale10 = -1 => round(value * 10)
     //          scale10 = 0  => round(value)
     static inline int32_t scaleAndRound(float value, int8_t scale10)
     {
-        // We only need a small set in this project. Keep it simple.
-        switch (scale10)
-        {
-        case -3:
-            return (int32_t)lroundf(value * 1000.0f);
-        case -2:
-            return (int32_t)lroundf(value * 100.0f);
-        case -1:
-            return (int32_t)lroundf(value * 10.0f);
-        case 0:
-            return (int32_t)lroundf(value);
-        case 1:
-            return (int32_t)lroundf(value / 10.0f);
-        default:
-            // Fallback: best-effort (avoid powf on MCUs).
-            // For unusual scales, caller should provide pre-scaled ints.
-            return (int32_t)lroundf(value);
-        }
+        return (int32_t)lroundf(applyScale(value, -scale10));
     }
 
     static inline TiltedValueItem makeItemI32(TiltedValueType type, int32_t value, int8_t scale10 = 0)
@@ -77,4 +97,54 @@ namespace TiltedValueHelper
     {
         return makeItemI32(TiltedValueType::RssiDbm, dbm, 0);
     }
+
+    static inline TiltedValueItem sampleCount(int32_t samples)
+    {
+        return makeItemI32(TiltedValueType::SampleCount, samples, 0);
+    }
+
+    static inline TiltedValueItem txRetries(int32_t retries)
+    {
+        return makeItemI32(TiltedValueType::TxRetries, retries, 0);
+    }
+
+    static inline TiltedValueItem sequence(uint32_t seq)
+    {
+        return makeItemI32(TiltedValueType::Sequence, (int32_t)seq, 0);
+    }
+
+    static inline TiltedValueItem awakeMs(int32_t ms)
+    {
+        return makeItemI32(TiltedValueType::AwakeMs, ms, 0);
+    }
+
+    static inline TiltedValueItem radioMs(int32_t ms)
+    {
+        return makeItemI32(TiltedValueType::RadioMs, ms, 0);
+    }
+
+    static inline TiltedValueItem resetReason(int32_t reason)
+    {
+        return makeItemI32(TiltedValueType::ResetReason, reason, 0);
+    }
+
+    static inline TiltedValueItem heartbeatS(int32_t seconds)
+    {
+        return makeItemI32(TiltedValueType::HeartbeatS, seconds, 0);
+    }
+
+    static inline TiltedValueItem configVersion(uint16_t version)
+    {
+        return makeItemI32(TiltedValueType::ConfigVersion, version, 0);
+    }
+
+    static inline TiltedValueItem tiltDeadband(float deg)
+    {
+        return makeItemI32(TiltedValueType::TiltDeadband, scaleAndRound(deg, -1), -1);
+    }
+
+    static inline TiltedValueItem tempDeadband(float c)
+    {
+        return makeItemI32(TiltedValueType::TempDeadband, scaleAndRound(c, -1), -1);
+    }
 }
@@ -0,0 +1,77 @@
+// Throughput of the v1 TLV encoder and decoder, in ns per packet, across item
+// counts. Run it before and after touching tilted_protocol.h or
+// tilted_packet_builder.h; absolute numbers are host numbers, the ratios
+// carry over to the chips.
+//
+//   bench_tlv [iterations]   (default 1000000 per item count)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "tilted_packet_builder.h"
+#include "tilted_protocol.h"
+#include "tilted_value_helper.h"
+
+// Keeps the compiler from dropping the work being timed.
+static volatile uint32_t benchSink;
+
+static double nsPer(std::chrono::steady_clock::time_point start, unsigned long iterations)
+{
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (double)iterations;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned long iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000UL;
+    if (iterations == 0)
+        return 1;
+
+    static const char name[] = "tilt-1a2b3c4d";
+    const uint8_t nameLen = sizeof(name) - 1;
+    // The most items a named packet fits in one ESP-NOW frame.
+    const uint8_t maxItems = (TILTED_MAX_FRAME_LEN - sizeof(TiltedReadingsHeader) - nameLen) / sizeof(TiltedValueItem);
+
+    TiltedValueItem items[64];
+    for (uint8_t i = 0; i < maxItems; i++)
+        items[i] = TiltedValueHelper::batteryMv(3000 + i);
+
+    printf("%6s %6s %14s %14s\n", "items", "bytes", "encode ns/pkt", "decode ns/pkt");
+    const uint8_t counts[] = {1, 3, 8, 16, maxItems};
+    for (const uint8_t count : counts)
+    {
+        uint8_t frame[TILTED_MAX_FRAME_LEN];
+        uint32_t sum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        uint16_t len = 0;
+        for (unsigned long k = 0; k < iterations; k++)
+        {
+            items[0].value = (int32_t)k;
+            len = tilted_encode_readings_packet(frame, sizeof(frame), 0x1a2b3c4d, 900, name, nameLen, items, count);
+            sum += frame[len - 1];
+        }
+        const double encodeNs = nsPer(start, iterations);
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned long k = 0; k < iterations; k++)
+        {
+            // Vary the input so the decode cannot be hoisted out of the loop.
+            frame[len - 1] = (uint8_t)k;
+            TiltedReadingsView view{};
+            if (tilted_decode_readings_view(frame, len, view))
+            {
+                for (const TiltedValueItem it : tilted_items(view))
+                    sum += (uint32_t)it.value;
+            }
+        }
+        const double decodeNs = nsPer(start, iterations);
+
+        benchSink = sum;
+        printf("%6u %6u %14.1f %14.1f\n", (unsigned)count, (unsigned)len, encodeNs, decodeNs);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Fuzz target for the frame decoders the gateway runs on untrusted ESP-NOW
+// input: tilted_decode_readings_view, tilted_decode_batch_view and
+// tilted_decode_compact_view, plus what the gateway does with a frame that
+// decodes (item iteration, JSON encoding, appending an item).
+//
+// Every input is copied into a buffer of exactly its size, once aligned and
+// once at an odd address, so ASan catches any read past the frame and UBSan
+// any misaligned access through the packed structs.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tilted_compact.h"
+#include "tilted_json_writer.h"
+#include "tilted_packet_builder.h"
+#include "tilted_protocol.h"
+
+// Fails loudly so both drivers report the input.
+#define FUZZ_ASSERT(cond)  \
+    do                     \
+    {                      \
+        if (!(cond))       \
+            abort();       \
+    } while (0)
+
+static volatile uint32_t fuzzSink;
+
+static void checkReadings(const uint8_t* buf, uint16_t len)
+{
+    TiltedReadingsView view{};
+    if (!tilted_decode_readings_view(buf, len, view))
+        return;
+
+    uint32_t sum = 0;
+    for (const TiltedValueItem it : tilted_items(view))
+        sum += (uint32_t)it.value + it.type;
+    fuzzSink = sum;
+
+    // A frame that decodes re-encodes to the same bytes.
+    uint8_t again[TILTED_MAX_FRAME_LEN + 64];
+    TiltedValueItem items[0xFF];
+    for (uint8_t i = 0; i < view.header.itemCount; i++)
+        items[i] = tilted_items(view)[i];
+    const uint16_t n = tilted_encode_readings_packet(again, sizeof(again), view.header.chipId,
+                                                     view.header.interval_s, view.name, view.header.nameLen,
+                                                     items, view.header.itemCount);
+    if (len <= sizeof(again))
+        FUZZ_ASSERT(n == len && memcmp(again, buf, len) == 0);
+
+    char json[1024];
+    const uint16_t jsonLen = tilted_encode_readings_json(json, sizeof(json), view, true, 104512);
+    FUZZ_ASSERT(jsonLen <= sizeof(json));
+    char tiny[16];
+    FUZZ_ASSERT(tilted_encode_readings_json(tiny, sizeof(tiny), view, false, 0) <= sizeof(tiny));
+
+    if (len <= sizeof(again) && view.header.itemCount < 0xFF)
+    {
+        memcpy(again, buf, len);
+        const uint16_t grown = tilted_append_readings_item(again, len, sizeof(again), TiltedValueItem{6, 0, 0, -70});
+        FUZZ_ASSERT(grown == 0 || grown == len + sizeof(TiltedValueItem));
+    }
+}
+
+static void checkBatch(const uint8_t* buf, uint16_t len)
+{
+    TiltedBatchView batch{};
+    if (!tilted_decode_batch_view(buf, len, batch))
+        return;
+
+    uint16_t offset = 0;
+    TiltedBatchSetView set{};
+    uint16_t sets = 0;
+    uint32_t sum = 0;
+    while (tilted_batch_next_set(batch, offset, set))
+    {
+        for (const TiltedValueItem it : tilted_items(set))
+            sum += (uint32_t)it.value;
+        sets++;
+    }
+    fuzzSink = sum;
+    FUZZ_ASSERT(sets == batch.header.itemCount);
+    FUZZ_ASSERT(offset == batch.setsLen);
+}
+
+static void checkCompact(const uint8_t* buf, uint16_t len)
+{
+    TiltedCompactView compact{};
+    if (!tilted_decode_compact_view(buf, len, compact))
+        return;
+    FUZZ_ASSERT(compact.nameLen <= TILTED_MAX_NAME_LEN);
+
+    TiltedCompactCursor cursor{};
+    TiltedValueItem items[TILTED_COMPACT_MAX_ITEMS];
+    uint32_t ageS = 0;
+    uint8_t itemCount = 0;
+    uint16_t sets = 0;
+    uint32_t sum = 0;
+    while (tilted_compact_next_set(compact, cursor, ageS, items, itemCount))
+    {
+        FUZZ_ASSERT(itemCount <= TILTED_COMPACT_MAX_ITEMS);
+        for (uint8_t i = 0; i < itemCount; i++)
+            sum += (uint32_t)items[i].value;
+        sets++;
+    }
+    fuzzSink = sum;
+    FUZZ_ASSERT(sets == compact.setCount);
+}
+
+static void checkAll(const uint8_t* buf, uint16_t len)
+{
+    checkReadings(buf, len);
+    checkBatch(buf, len);
+    checkCompact(buf, len);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    // Longer than any uint16_t length the decoders take.
+    if (size > 0xFFFF)
+        return 0;
+    const uint16_t len = (uint16_t)size;
+
+    // calloc so a zero-length input still points at initialised memory.
+    uint8_t* exact = static_cast<uint8_t*>(calloc(size ? size : 1, 1));
+    if (size)
+        memcpy(exact, data, size);
+    checkAll(exact, len);
+    free(exact);
+
+    uint8_t* odd = static_cast<uint8_t*>(calloc(size + 1, 1));
+    if (size)
+        memcpy(odd + 1, data, size);
+    checkAll(odd + 1, len);
+    free(odd);
+    return 0;
+}
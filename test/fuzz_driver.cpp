@@ -0,0 +1,164 @@
+// Stand-alone driver for LLVMFuzzerTestOneInput, for compilers without
+// libFuzzer. Mutates a handful of valid frames of every kind (byte flips,
+// truncation, growth, splices) and keeps interesting results as new seeds.
+//
+//   fuzz_decoders [-runs=N] [-seed=S]   random campaign (default 100000 runs)
+//   fuzz_decoders file...              replay inputs, e.g. a libFuzzer crash
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "tilted_compact.h"
+#include "tilted_packet_builder.h"
+#include "tilted_protocol.h"
+#include "tilted_value_helper.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+using Frame = std::vector<uint8_t>;
+
+static std::vector<Frame> seedFrames()
+{
+    std::vector<Frame> seeds;
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const TiltedValueItem items[] = {
+        TiltedValueHelper::tiltDeg(45.2f),
+        TiltedValueHelper::tempC(20.1f),
+        TiltedValueHelper::batteryMv(3712),
+        TiltedValueHelper::sequence(7),
+    };
+    const TiltedValueItem later[] = {
+        TiltedValueHelper::tiltDeg(44.9f),
+        TiltedValueHelper::tempC(20.3f),
+        TiltedValueHelper::batteryMv(3709),
+        TiltedValueHelper::sequence(8),
+    };
+    const TiltedBatchSet sets[] = {{900, items, 4}, {0, later, 4}};
+
+    auto add = [&](uint16_t n) {
+        if (n != 0)
+            seeds.emplace_back(buf, buf + n);
+    };
+    add(tilted_encode_readings_packet(buf, sizeof(buf), 0x1a2b3c4d, 900, "tilt-1a2b3c4d", 13, items, 4));
+    add(tilted_encode_readings_packet(buf, sizeof(buf), 1, 60, "", 0, nullptr, 0));
+    add(tilted_encode_batch_packet(buf, sizeof(buf), 0x1a2b3c4d, 900, "tilt", 4, sets, 2));
+    add(tilted_encode_compact_packet(buf, sizeof(buf), 0x1a2b3c4d, 900, "tilt", 4, items, 4));
+    add(tilted_encode_compact_packet(buf, sizeof(buf), 0x1a2b3c4d, 900, nullptr, 0, items, 4));
+    add(tilted_encode_compact_batch(buf, sizeof(buf), 0x1a2b3c4d, 900, nullptr, 0, sets, 2));
+    return seeds;
+}
+
+static void mutate(Frame& f, std::mt19937& rng, const std::vector<Frame>& pool)
+{
+    const int count = 1 + (int)(rng() % 4);
+    for (int m = 0; m < count; m++)
+    {
+        switch (rng() % 6)
+        {
+        case 0:
+            if (!f.empty())
+                f[rng() % f.size()] = (uint8_t)rng();
+            break;
+        case 1:
+            if (!f.empty())
+                f[rng() % f.size()] ^= (uint8_t)(1u << (rng() % 8));
+            break;
+        case 2:
+            if (!f.empty())
+                f.resize(rng() % f.size());
+            break;
+        case 3:
+            f.push_back((uint8_t)rng());
+            break;
+        case 4:
+        {
+            // Splice the tail of another input.
+            const Frame& other = pool[rng() % pool.size()];
+            if (!other.empty() && !f.empty())
+            {
+                const size_t at = rng() % f.size();
+                const size_t from = rng() % other.size();
+                f.resize(at);
+                f.insert(f.end(), other.begin() + from, other.end());
+            }
+            break;
+        }
+        default:
+            // Boundary values are where length checks go wrong.
+            if (!f.empty())
+            {
+                static const uint8_t edges[] = {0x00, 0x01, 0x7F, 0x80, 0xFE, 0xFF};
+                f[rng() % f.size()] = edges[rng() % sizeof(edges)];
+            }
+            break;
+        }
+    }
+}
+
+static int replayFile(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    Frame data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(file);
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long runs = 100000;
+    unsigned long seed = 1;
+    int files = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+            runs = strtoul(argv[i] + 6, nullptr, 10);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            seed = strtoul(argv[i] + 6, nullptr, 10);
+        else if (replayFile(argv[i]) != 0)
+            return 1;
+        else
+            files++;
+    }
+    if (files != 0)
+    {
+        printf("replayed %d input(s)\n", files);
+        return 0;
+    }
+
+    std::mt19937 rng((uint32_t)seed);
+    const std::vector<Frame> seeds = seedFrames();
+    std::vector<Frame> pool = seeds;
+    for (const Frame& s : seeds)
+        LLVMFuzzerTestOneInput(s.data(), s.size());
+
+    for (unsigned long run = 0; run < runs; run++)
+    {
+        Frame f = pool[rng() % pool.size()];
+        mutate(f, rng, pool);
+        LLVMFuzzerTestOneInput(f.data(), f.size());
+
+        // Keep some mutants so damage accumulates; restart from the valid
+        // seeds now and then so the pool does not drift into pure noise.
+        if (rng() % 4 == 0 && f.size() <= 2 * TILTED_MAX_FRAME_LEN)
+            pool.push_back(f);
+        if (pool.size() > 4096)
+            pool = seeds;
+    }
+    printf("%lu runs, seed %lu\n", runs, seed);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Just enough of <Arduino.h> for the host build: the code under test only
+// uses the C headers it pulls in and names String in declarations.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+class String
+{
+public:
+    String(const char* s = "") : s_(s ? s : "") {}
+
+    const char* c_str() const { return s_.c_str(); }
+    size_t length() const { return s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+
+private:
+    std::string s_;
+};
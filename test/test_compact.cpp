@@ -0,0 +1,258 @@
+// tilted_compact.h: the zigzag/varint codec, single and batch round trips
+// (explicit scales, deltas that wrap), and truncated, padded or malformed
+// frames being rejected.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include "tilted_check.h"
+#include "tilted_compact.h"
+#include "tilted_value_helper.h"
+
+static const char NAME[] = "tilt-1a2b3c4d";
+static const uint8_t NAME_LEN = sizeof(NAME) - 1;
+
+static void testZigzag()
+{
+    CHECK_EQ(tilted_zigzag(0), 0);
+    CHECK_EQ(tilted_zigzag(-1), 1);
+    CHECK_EQ(tilted_zigzag(1), 2);
+    CHECK_EQ(tilted_zigzag(-2), 3);
+    CHECK_EQ(tilted_zigzag(INT32_MAX), 0xFFFFFFFEu);
+    CHECK_EQ(tilted_zigzag(INT32_MIN), 0xFFFFFFFFu);
+    for (int32_t v : {0, 1, -1, 63, -64, 64, 1000000, -1000000, INT32_MAX, INT32_MIN})
+        CHECK_EQ(tilted_unzigzag(tilted_zigzag(v)), v);
+}
+
+static void testVarint()
+{
+    struct
+    {
+        uint32_t value;
+        uint8_t bytes;
+    } cases[] = {{0, 1}, {127, 1}, {128, 2}, {300, 2}, {16383, 2}, {16384, 3}, {0x0FFFFFFF, 4}, {UINT32_MAX, 5}};
+
+    for (const auto& c : cases)
+    {
+        uint8_t buf[8];
+        TiltedCompactWriter w{buf, sizeof(buf), 0, false};
+        tilted_compact_put_varint(w, c.value);
+        CHECK(!w.overflow);
+        CHECK_EQ(w.len, c.bytes);
+
+        TiltedCompactReader r{buf, w.len, 0, false};
+        CHECK_EQ(tilted_compact_get_varint(r), c.value);
+        CHECK(!r.bad);
+        CHECK_EQ(r.pos, c.bytes);
+
+        // Every byte but the last carries the continuation bit.
+        TiltedCompactReader cut{buf, (uint16_t)(w.len - 1), 0, false};
+        tilted_compact_get_varint(cut);
+        CHECK(cut.bad);
+    }
+
+    const uint8_t b300[] = {0xAC, 0x02};
+    TiltedCompactReader r{b300, 2, 0, false};
+    CHECK_EQ(tilted_compact_get_varint(r), 300);
+
+    // Six bytes is longer than any uint32_t needs.
+    const uint8_t overlong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    TiltedCompactReader o{overlong, sizeof(overlong), 0, false};
+    tilted_compact_get_varint(o);
+    CHECK(o.bad);
+
+    uint8_t small[1];
+    TiltedCompactWriter w{small, sizeof(small), 0, false};
+    tilted_compact_put_varint(w, 128);
+    CHECK(w.overflow);
+}
+
+static void checkItemsEqual(const TiltedValueItem* a, const TiltedValueItem* b, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; i++)
+    {
+        CHECK_EQ(a[i].type, b[i].type);
+        CHECK_EQ(a[i].scale10, b[i].scale10);
+        CHECK_EQ(a[i].value, b[i].value);
+    }
+}
+
+static void testSingleRoundTrip()
+{
+    const TiltedValueItem items[] = {
+        TiltedValueHelper::tiltDeg(45.2f),
+        TiltedValueHelper::tempC(-3.4f),
+        TiltedValueHelper::batteryMv(3712),
+        {(uint8_t)TiltedValueType::Temp, -2, 0, 1955}, // not the default scale
+        TiltedValueHelper::sequence(0xFFFFFFFFu),
+    };
+    const uint8_t count = sizeof(items) / sizeof(items[0]);
+
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    for (bool withName : {true, false})
+    {
+        const uint16_t len = tilted_encode_compact_packet(buf, sizeof(buf), 0x1a2b3c4d, 900,
+                                                          withName ? NAME : nullptr, NAME_LEN, items, count);
+        CHECK(len > 0);
+
+        TiltedCompactView view{};
+        CHECK(tilted_decode_compact_view(buf, len, view));
+        CHECK_EQ(view.chipId, 0x1a2b3c4d);
+        CHECK_EQ(view.intervalS, 900);
+        CHECK_EQ(view.setCount, 1);
+        CHECK(!view.batch);
+        if (withName)
+        {
+            CHECK_EQ(view.nameLen, NAME_LEN);
+            CHECK(view.name && memcmp(view.name, NAME, NAME_LEN) == 0);
+        }
+        else
+        {
+            CHECK(view.name == nullptr);
+        }
+
+        TiltedCompactCursor cursor{};
+        TiltedValueItem out[TILTED_COMPACT_MAX_ITEMS];
+        uint32_t age = 99;
+        uint8_t n = 0;
+        CHECK(tilted_compact_next_set(view, cursor, age, out, n));
+        CHECK_EQ(age, 0);
+        CHECK_EQ(n, count);
+        checkItemsEqual(out, items, count);
+        CHECK(!tilted_compact_next_set(view, cursor, age, out, n));
+    }
+
+    // Shorter on air than the same reading as v1 TLV.
+    const uint16_t compact = tilted_encode_compact_packet(buf, sizeof(buf), 1, 900, NAME, NAME_LEN, items, count);
+    const uint16_t tlv = tilted_encode_readings_packet(buf, sizeof(buf), 1, 900, NAME, NAME_LEN, items, count);
+    CHECK(compact < tlv);
+}
+
+static void testBatchDeltas()
+{
+    const TiltedValueItem s0[] = {TiltedValueHelper::tiltDeg(45.0f), {(uint8_t)TiltedValueType::Sequence, 0, 0, INT32_MAX}};
+    const TiltedValueItem s1[] = {TiltedValueHelper::tiltDeg(44.9f), {(uint8_t)TiltedValueType::Sequence, 0, 0, INT32_MIN}};
+    // Different layout: a type change at position 0 can't be a delta.
+    const TiltedValueItem s2[] = {TiltedValueHelper::tempC(20.0f), TiltedValueHelper::tiltDeg(44.8f),
+                                  TiltedValueHelper::batteryMv(3300)};
+    const TiltedValueItem s3[] = {TiltedValueHelper::tempC(20.1f)};
+    const TiltedBatchSet sets[] = {{2700, s0, 2}, {1800, s1, 2}, {900, s2, 3}, {0, s3, 1}};
+
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = tilted_encode_compact_batch(buf, sizeof(buf), 7, 900, NAME, NAME_LEN, sets, 4);
+    CHECK(len > 0);
+
+    TiltedCompactView view{};
+    CHECK(tilted_decode_compact_view(buf, len, view));
+    CHECK(view.batch);
+    CHECK_EQ(view.setCount, 4);
+
+    TiltedCompactCursor cursor{};
+    TiltedValueItem out[TILTED_COMPACT_MAX_ITEMS];
+    uint32_t age;
+    uint8_t n;
+    for (const TiltedBatchSet& s : sets)
+    {
+        CHECK(tilted_compact_next_set(view, cursor, age, out, n));
+        CHECK_EQ(age, s.ageS);
+        CHECK_EQ(n, s.itemCount);
+        checkItemsEqual(out, s.items, n);
+    }
+    CHECK(!tilted_compact_next_set(view, cursor, age, out, n));
+
+    // One set encodes exactly like the single-reading encoder.
+    uint8_t single[TILTED_MAX_FRAME_LEN];
+    const uint16_t a = tilted_encode_compact_batch(buf, sizeof(buf), 7, 900, NAME, NAME_LEN, sets, 1);
+    const uint16_t b = tilted_encode_compact_packet(single, sizeof(single), 7, 900, NAME, NAME_LEN, s0, 2);
+    CHECK_EQ(a, b);
+    CHECK(memcmp(buf, single, a) == 0);
+}
+
+static void testRejectsTruncatedAndPadded()
+{
+    const TiltedValueItem s0[] = {TiltedValueHelper::tiltDeg(45.0f), TiltedValueHelper::batteryMv(3700)};
+    const TiltedValueItem s1[] = {TiltedValueHelper::tiltDeg(44.0f), TiltedValueHelper::batteryMv(3690)};
+    const TiltedBatchSet sets[] = {{900, s0, 2}, {0, s1, 2}};
+
+    uint8_t buf[TILTED_MAX_FRAME_LEN + 1];
+    const uint16_t len = tilted_encode_compact_batch(buf, TILTED_MAX_FRAME_LEN, 7, 60000, NAME, NAME_LEN, sets, 2);
+    CHECK(len > 0);
+
+    TiltedCompactView view{};
+    for (uint16_t n = 0; n < len; n++)
+        CHECK(!tilted_decode_compact_view(buf, n, view));
+    buf[len] = 0;
+    CHECK(!tilted_decode_compact_view(buf, len + 1, view));
+    CHECK(!tilted_decode_compact_view(nullptr, len, view));
+
+    buf[0] ^= 0x01;
+    CHECK(!tilted_decode_compact_view(buf, len, view));
+}
+
+static void testRejectsMalformed()
+{
+    // magic, chipId, interval 60, flags 0, then one set.
+    const uint8_t prefix[] = {0x32, 0x54, 1, 0, 0, 0, 60, 0};
+    TiltedCompactView view{};
+    uint8_t buf[64];
+
+    // A delta in the first set has nothing to apply to.
+    memcpy(buf, prefix, sizeof(prefix));
+    const uint8_t deltaFirst[] = {1, (uint8_t)TiltedValueType::Tilt | TILTED_COMPACT_ITEM_DELTA, 2};
+    memcpy(buf + sizeof(prefix), deltaFirst, sizeof(deltaFirst));
+    CHECK(!tilted_decode_compact_view(buf, sizeof(prefix) + sizeof(deltaFirst), view));
+
+    // More items than the decoder's delta state holds.
+    buf[sizeof(prefix)] = TILTED_COMPACT_MAX_ITEMS + 1;
+    memset(buf + sizeof(prefix) + 1, 0, 2 * (TILTED_COMPACT_MAX_ITEMS + 1));
+    CHECK(!tilted_decode_compact_view(buf, sizeof(prefix) + 1 + 2 * (TILTED_COMPACT_MAX_ITEMS + 1), view));
+
+    // An interval that does not fit uint16_t.
+    const uint8_t wideInterval[] = {0x32, 0x54, 1, 0, 0, 0, 0x80, 0x80, 0x04, 0, 0};
+    CHECK(!tilted_decode_compact_view(wideInterval, sizeof(wideInterval), view));
+
+    // A batch of zero sets, and a name longer than the protocol allows.
+    const uint8_t noSets[] = {0x32, 0x54, 1, 0, 0, 0, 60, TILTED_COMPACT_FLAG_BATCH, 0};
+    CHECK(!tilted_decode_compact_view(noSets, sizeof(noSets), view));
+    memcpy(buf, prefix, sizeof(prefix));
+    buf[7] = TILTED_COMPACT_FLAG_NAME;
+    buf[8] = TILTED_MAX_NAME_LEN + 1;
+    memset(buf + 9, 'x', TILTED_MAX_NAME_LEN + 1);
+    buf[9 + TILTED_MAX_NAME_LEN + 1] = 0; // empty set
+    CHECK(!tilted_decode_compact_view(buf, 9 + TILTED_MAX_NAME_LEN + 2, view));
+    buf[8] = TILTED_MAX_NAME_LEN;
+    buf[9 + TILTED_MAX_NAME_LEN] = 0;
+    CHECK(tilted_decode_compact_view(buf, 9 + TILTED_MAX_NAME_LEN + 1, view));
+}
+
+static void testEncoderLimits()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    TiltedValueItem many[TILTED_COMPACT_MAX_ITEMS + 1]{};
+    CHECK(tilted_encode_compact_packet(buf, sizeof(buf), 1, 1, nullptr, 0, many, TILTED_COMPACT_MAX_ITEMS) > 0);
+    CHECK_EQ(tilted_encode_compact_packet(buf, sizeof(buf), 1, 1, nullptr, 0, many, TILTED_COMPACT_MAX_ITEMS + 1), 0);
+
+    const TiltedValueItem wideType[] = {{TILTED_COMPACT_TYPE_MASK + 1, 0, 0, 1}};
+    CHECK_EQ(tilted_encode_compact_packet(buf, sizeof(buf), 1, 1, nullptr, 0, wideType, 1), 0);
+
+    const TiltedValueItem one[] = {TiltedValueHelper::tiltDeg(1.0f)};
+    const uint16_t len = tilted_encode_compact_packet(buf, sizeof(buf), 1, 1, NAME, NAME_LEN, one, 1);
+    CHECK_EQ(tilted_encode_compact_packet(buf, len - 1, 1, 1, NAME, NAME_LEN, one, 1), 0);
+    CHECK_EQ(tilted_encode_compact_packet(buf, len, 1, 1, NAME, NAME_LEN, one, 1), len);
+    CHECK_EQ(tilted_encode_compact_packet(nullptr, sizeof(buf), 1, 1, NAME, NAME_LEN, one, 1), 0);
+    CHECK_EQ(tilted_encode_compact_batch(buf, sizeof(buf), 1, 1, NAME, NAME_LEN, nullptr, 1), 0);
+}
+
+int main()
+{
+    RUN(testZigzag);
+    RUN(testVarint);
+    RUN(testSingleRoundTrip);
+    RUN(testBatchDeltas);
+    RUN(testRejectsTruncatedAndPadded);
+    RUN(testRejectsMalformed);
+    RUN(testEncoderLimits);
+    return TEST_RESULT();
+}
@@ -0,0 +1,179 @@
+// FrameQueue (gateway/src/frame_queue.h): FIFO order, full and oversized
+// drops, reserve()/commit(), index wraparound and a two-thread SPSC run.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+
+#include "frame_queue.h"
+#include "tilted_check.h"
+
+static void testFifoOrder()
+{
+    FrameQueue<4, 8> q;
+    CHECK(q.empty());
+    uint16_t len = 99;
+    CHECK(q.front(len) == nullptr);
+    CHECK_EQ(len, 0);
+
+    for (uint8_t i = 1; i <= 3; i++)
+    {
+        const uint8_t frame[] = {i, (uint8_t)(i * 2), (uint8_t)(i * 3)};
+        CHECK(q.push(frame, i));
+    }
+    CHECK_EQ(q.depth(), 3);
+
+    for (uint8_t i = 1; i <= 3; i++)
+    {
+        const uint8_t* f = q.front(len);
+        CHECK(f != nullptr);
+        CHECK_EQ(len, i);
+        CHECK_EQ(f[0], i);
+        q.pop();
+    }
+    CHECK(q.empty());
+    q.pop(); // popping an empty queue is a no-op
+    CHECK_EQ(q.depth(), 0);
+}
+
+static void testFullQueueDropsNewest()
+{
+    FrameQueue<4, 8> q;
+    for (uint8_t i = 0; i < 4; i++)
+        CHECK(q.push(&i, 1));
+    const uint8_t late = 0xEE;
+    CHECK(!q.push(&late, 1));
+    CHECK(q.reserve() == nullptr);
+    CHECK_EQ(q.drops(), 2);
+    CHECK_EQ(q.depth(), 4);
+    CHECK_EQ(q.highWater(), 4);
+
+    // The unread frames are intact and still in order.
+    uint16_t len;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK_EQ(*q.front(len), i);
+        q.pop();
+    }
+    CHECK(q.push(&late, 1));
+    CHECK_EQ(*q.front(len), late);
+}
+
+static void testRejectsBadFrames()
+{
+    FrameQueue<2, 8> q;
+    uint8_t big[9] = {};
+    CHECK(q.push(big, 8));
+    CHECK(!q.push(big, 9));
+    CHECK(!q.push(big, 0));
+    CHECK(!q.push(nullptr, 1));
+    CHECK_EQ(q.drops(), 3);
+    CHECK_EQ(q.depth(), 1);
+}
+
+static void testReserveCommit()
+{
+    FrameQueue<2, 8> q;
+    uint8_t* slot = q.reserve();
+    CHECK(slot != nullptr);
+    memcpy(slot, "abc", 3);
+    CHECK(q.empty()); // nothing visible before commit()
+    q.commit(3);
+    CHECK_EQ(q.depth(), 1);
+
+    // Abandoned and oversized commits publish nothing; the slot is reused.
+    uint8_t* again = q.reserve();
+    q.commit(0);
+    q.commit(9);
+    CHECK_EQ(q.depth(), 1);
+    CHECK(q.reserve() == again);
+
+    uint16_t len;
+    const uint8_t* f = q.front(len);
+    CHECK_EQ(len, 3);
+    CHECK(memcmp(f, "abc", 3) == 0);
+    CHECK_EQ(q.drops(), 0);
+}
+
+static void testWraparoundAndClear()
+{
+    FrameQueue<4, 4> q;
+    uint16_t len;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const uint8_t a = (uint8_t)i, b = (uint8_t)(i + 1);
+        CHECK(q.push(&a, 1));
+        CHECK(q.push(&b, 1));
+        CHECK_EQ(*q.front(len), a);
+        q.pop();
+        CHECK_EQ(*q.front(len), b);
+        q.pop();
+    }
+    CHECK_EQ(q.highWater(), 2);
+
+    const uint8_t x = 1;
+    q.push(&x, 1);
+    q.push(&x, 1);
+    q.push(&x, 1);
+    q.clear();
+    CHECK(q.empty());
+    CHECK(q.front(len) == nullptr);
+    CHECK_EQ(q.highWater(), 3);
+}
+
+static void testTwoThreads()
+{
+    static FrameQueue<8, 8> q;
+    constexpr uint32_t FRAMES = 50000;
+    uint32_t dropped = 0;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < FRAMES; i++)
+        {
+            uint8_t frame[8];
+            memcpy(frame, &i, sizeof(i));
+            memcpy(frame + 4, &i, sizeof(i));
+            while (!q.push(frame, sizeof(frame)))
+            {
+                dropped++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool ordered = true;
+    while (expected < FRAMES)
+    {
+        uint16_t len;
+        const uint8_t* f = q.front(len);
+        if (!f)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t a, b;
+        memcpy(&a, f, sizeof(a));
+        memcpy(&b, f + 4, sizeof(b));
+        ordered = ordered && len == 8 && a == expected && b == expected;
+        q.pop();
+        expected++;
+    }
+    producer.join();
+
+    CHECK(ordered);
+    CHECK(q.empty());
+    CHECK_EQ(q.drops(), dropped);
+}
+
+int main()
+{
+    RUN(testFifoOrder);
+    RUN(testFullQueueDropsNewest);
+    RUN(testRejectsBadFrames);
+    RUN(testReserveCommit);
+    RUN(testWraparoundAndClear);
+    RUN(testTwoThreads);
+    return TEST_RESULT();
+}
@@ -0,0 +1,168 @@
+// tilted_json_writer.h: fixed-point formatting, string escapes, member
+// separators and the readings payload, including buffers that are too small.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tilted_check.h"
+#include "tilted_json_writer.h"
+#include "tilted_packet_builder.h"
+#include "tilted_value_helper.h"
+
+#define CHECK_JSON(w, expected)                                      \
+    do                                                               \
+    {                                                                \
+        CHECK(!(w).overflow);                                        \
+        CHECK_EQ((w).len, strlen(expected));                         \
+        CHECK(memcmp((w).buf, expected, strlen(expected)) == 0);     \
+    } while (0)
+
+static void checkFixed(int32_t mantissa, int8_t scale10, const char* expected)
+{
+    char buf[32];
+    TiltedJsonWriter w;
+    tilted_json_init(w, buf, sizeof(buf));
+    tilted_json_fixed(w, mantissa, scale10);
+    if (w.len != strlen(expected) || memcmp(buf, expected, w.len) != 0)
+        fprintf(stderr, "  fixed(%d, %d) = %.*s, want %s\n", mantissa, scale10, w.len, buf, expected);
+    CHECK_JSON(w, expected);
+}
+
+static void testFixed()
+{
+    checkFixed(234, -1, "23.4");
+    checkFixed(3310, -3, "3.310");
+    checkFixed(5, -3, "0.005");
+    checkFixed(-5, -1, "-0.5");
+    checkFixed(-1234, -2, "-12.34");
+    checkFixed(0, 0, "0");
+    checkFixed(0, -2, "0.00");
+    checkFixed(12, 2, "1200");
+    checkFixed(-7, 0, "-7");
+    checkFixed(105012, -5, "1.05012");
+    checkFixed(INT32_MAX, -9, "2.147483647");
+    checkFixed(INT32_MIN, 0, "-2147483648");
+    checkFixed(INT32_MIN, -12, "-0.002147483648");
+}
+
+static void testStringEscapes()
+{
+    char buf[64];
+    TiltedJsonWriter w;
+    tilted_json_init(w, buf, sizeof(buf));
+    const char raw[] = {'a', '"', 'b', '\\', '\n', 0x01, 0x1f, 'z'};
+    tilted_json_string(w, raw, sizeof(raw));
+    CHECK_JSON(w, "\"a\\\"b\\\\\\u000a\\u0001\\u001fz\"");
+}
+
+static void testMembersAndNesting()
+{
+    char buf[64];
+    TiltedJsonWriter w;
+    tilted_json_init(w, buf, sizeof(buf));
+    tilted_json_begin_object(w);
+    tilted_json_key(w, "a");
+    tilted_json_fixed(w, 1, 0);
+    tilted_json_key(w, "b");
+    tilted_json_begin_object(w);
+    tilted_json_key(w, "c");
+    tilted_json_fixed(w, 2, 0);
+    tilted_json_end_object(w);
+    tilted_json_key(w, "d");
+    tilted_json_fixed(w, 3, 0);
+    tilted_json_end_object(w);
+    CHECK_JSON(w, "{\"a\":1,\"b\":{\"c\":2},\"d\":3}");
+}
+
+static void testOverflowIsSticky()
+{
+    char buf[8];
+    memset(buf, '#', sizeof(buf));
+    TiltedJsonWriter w;
+    tilted_json_init(w, buf, 4);
+    tilted_json_put(w, "abc", 3);
+    tilted_json_put(w, "de", 2);
+    CHECK(w.overflow);
+    tilted_json_putc(w, 'f'); // would have fitted, but the output is already broken
+    CHECK_EQ(w.len, 3);
+    CHECK(buf[3] == '#' && buf[4] == '#');
+
+    tilted_json_init(w, nullptr, 16);
+    CHECK(w.overflow);
+    tilted_json_init(w, buf, 0);
+    CHECK(w.overflow);
+}
+
+static uint16_t makeView(uint8_t* frame, TiltedReadingsView& view)
+{
+    const TiltedValueItem items[] = {
+        TiltedValueHelper::tiltDeg(45.2f),
+        TiltedValueHelper::tempC(19.5f),
+        TiltedValueHelper::batteryMv(3310),
+        TiltedValueHelper::rssiDbm(-71),
+        {200, 0, 0, 1}, // unknown type: skipped
+        TiltedValueHelper::tiltDeadband(0.2f), // config-only type: skipped
+    };
+    const char name[] = "tilt\"1";
+    const uint16_t len = tilted_encode_readings_packet(frame, TILTED_MAX_FRAME_LEN, 1, 900, name, sizeof(name) - 1,
+                                                       items, sizeof(items) / sizeof(items[0]));
+    CHECK(tilted_decode_readings_view(frame, len, view));
+    return len;
+}
+
+static const char EXPECTED_READINGS[] =
+    "{\"name\":\"tilt\\\"1\",\"angle\":45.2,\"temp\":19.5,\"temp_unit\":\"C\",\"battery\":3.310,"
+    "\"rssi\":-71,\"gravity\":1.04800,\"gravity_unit\":\"G\"}";
+
+static void testReadingsJson()
+{
+    uint8_t frame[TILTED_MAX_FRAME_LEN];
+    TiltedReadingsView view{};
+    makeView(frame, view);
+
+    char out[256];
+    const uint16_t len = tilted_encode_readings_json(out, sizeof(out), view, true, 104800);
+    CHECK_EQ(len, sizeof(EXPECTED_READINGS) - 1);
+    CHECK(memcmp(out, EXPECTED_READINGS, len) == 0);
+
+    const uint16_t noGravity = tilted_encode_readings_json(out, sizeof(out), view, false, 0);
+    CHECK(noGravity > 0 && noGravity < len);
+    CHECK(out[noGravity - 1] == '}');
+    CHECK(memmem(out, noGravity, "gravity", 7) == nullptr);
+}
+
+static void testReadingsJsonTooSmall()
+{
+    uint8_t frame[TILTED_MAX_FRAME_LEN];
+    TiltedReadingsView view{};
+    makeView(frame, view);
+    const uint16_t need = sizeof(EXPECTED_READINGS) - 1;
+
+    char out[256];
+    for (uint16_t cap = 0; cap < need; cap++)
+    {
+        memset(out, '#', sizeof(out));
+        CHECK_EQ(tilted_encode_readings_json(out, cap, view, true, 104800), 0);
+        CHECK(out[cap] == '#'); // nothing written past the buffer
+    }
+    CHECK_EQ(tilted_encode_readings_json(out, need, view, true, 104800), need);
+}
+
+static void testReadingsJsonRejectsEmptyView()
+{
+    char out[64];
+    TiltedReadingsView view{};
+    CHECK_EQ(tilted_encode_readings_json(out, sizeof(out), view, false, 0), 0);
+}
+
+int main()
+{
+    RUN(testFixed);
+    RUN(testStringEscapes);
+    RUN(testMembersAndNesting);
+    RUN(testOverflowIsSticky);
+    RUN(testReadingsJson);
+    RUN(testReadingsJsonTooSmall);
+    RUN(testReadingsJsonRejectsEmptyView);
+    return TEST_RESULT();
+}
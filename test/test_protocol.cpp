@@ -0,0 +1,237 @@
+// v1 readings, batch and config frames (tilted_protocol.h,
+// tilted_packet_builder.h, tilted_value_helper.h): round trips, and
+// truncated, padded or corrupted frames being rejected.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tilted_check.h"
+#include "tilted_packet_builder.h"
+#include "tilted_protocol.h"
+#include "tilted_value_helper.h"
+
+static const char NAME[] = "tilt-1a2b3c4d";
+static const uint8_t NAME_LEN = sizeof(NAME) - 1;
+
+static const TiltedValueItem ITEMS[] = {
+    TiltedValueHelper::tiltDeg(45.2f),
+    TiltedValueHelper::tempC(-3.4f),
+    TiltedValueHelper::batteryMv(3712),
+    TiltedValueHelper::sequence(0xFFFFFFFFu),
+};
+static const uint8_t ITEM_COUNT = sizeof(ITEMS) / sizeof(ITEMS[0]);
+
+static uint16_t encodeReadings(uint8_t* buf, uint16_t max)
+{
+    return tilted_encode_readings_packet(buf, max, 0x1a2b3c4d, 900, NAME, NAME_LEN, ITEMS, ITEM_COUNT);
+}
+
+static void testReadingsRoundTrip()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = encodeReadings(buf, sizeof(buf));
+    CHECK_EQ(len, sizeof(TiltedReadingsHeader) + NAME_LEN + ITEM_COUNT * sizeof(TiltedValueItem));
+
+    TiltedReadingsView view{};
+    CHECK(tilted_decode_readings_view(buf, len, view));
+    CHECK_EQ(view.header.chipId, 0x1a2b3c4d);
+    CHECK_EQ(view.header.interval_s, 900);
+    CHECK_EQ(view.header.nameLen, NAME_LEN);
+    CHECK(memcmp(view.name, NAME, NAME_LEN) == 0);
+    CHECK_EQ(view.header.itemCount, ITEM_COUNT);
+
+    uint8_t i = 0;
+    for (const TiltedValueItem it : tilted_items(view))
+    {
+        CHECK_EQ(it.type, ITEMS[i].type);
+        CHECK_EQ(it.scale10, ITEMS[i].scale10);
+        CHECK_EQ(it.value, ITEMS[i].value);
+        i++;
+    }
+    CHECK_EQ(i, ITEM_COUNT);
+    CHECK_NEAR(TiltedValueHelper::toFloat(tilted_items(view)[0]), 45.2, 1e-4);
+    CHECK_NEAR(TiltedValueHelper::toFloat(tilted_items(view)[1]), -3.4, 1e-4);
+    CHECK_EQ((uint32_t)tilted_items(view)[3].value, 0xFFFFFFFFu);
+}
+
+static void testReadingsUnaligned()
+{
+    // Frames land at any offset in the receive queue's slots.
+    uint8_t raw[TILTED_MAX_FRAME_LEN + 3];
+    for (uint8_t offset = 1; offset <= 3; offset++)
+    {
+        const uint16_t len = encodeReadings(raw + offset, TILTED_MAX_FRAME_LEN);
+        TiltedReadingsView view{};
+        CHECK(tilted_decode_readings_view(raw + offset, len, view));
+        CHECK_EQ(tilted_items(view)[2].value, 3712);
+    }
+}
+
+static void testReadingsRejectsTruncatedAndPadded()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN + 1];
+    const uint16_t len = encodeReadings(buf, TILTED_MAX_FRAME_LEN);
+    TiltedReadingsView view{};
+    for (uint16_t n = 0; n < len; n++)
+        CHECK(!tilted_decode_readings_view(buf, n, view));
+    buf[len] = 0;
+    CHECK(!tilted_decode_readings_view(buf, len + 1, view));
+    CHECK(!tilted_decode_readings_view(nullptr, len, view));
+}
+
+static void testReadingsRejectsBadHeader()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = encodeReadings(buf, sizeof(buf));
+    TiltedReadingsView view{};
+
+    uint8_t bad[TILTED_MAX_FRAME_LEN];
+    memcpy(bad, buf, len);
+    bad[0] ^= 0x01;
+    CHECK(!tilted_decode_readings_view(bad, len, view));
+
+    // A name longer than the protocol allows, even if the length adds up.
+    memcpy(bad, buf, len);
+    bad[offsetof(TiltedReadingsHeader, nameLen)] = TILTED_MAX_NAME_LEN + 1;
+    bad[offsetof(TiltedReadingsHeader, itemCount)] = 0;
+    CHECK(!tilted_decode_readings_view(bad, sizeof(TiltedReadingsHeader) + TILTED_MAX_NAME_LEN + 1, view));
+
+    // An item count that claims more than the frame holds.
+    memcpy(bad, buf, len);
+    bad[offsetof(TiltedReadingsHeader, itemCount)] = ITEM_COUNT + 1;
+    CHECK(!tilted_decode_readings_view(bad, len, view));
+}
+
+static void testEncoderLimits()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = encodeReadings(buf, sizeof(buf));
+    CHECK_EQ(encodeReadings(buf, len - 1), 0);
+    CHECK_EQ(encodeReadings(buf, len), len);
+
+    char longName[TILTED_MAX_NAME_LEN + 1];
+    memset(longName, 'x', sizeof(longName));
+    CHECK_EQ(tilted_encode_readings_packet(buf, sizeof(buf), 1, 1, longName, sizeof(longName), ITEMS, 1), 0);
+    CHECK_EQ(tilted_encode_readings_packet(buf, sizeof(buf), 1, 1, longName, TILTED_MAX_NAME_LEN, ITEMS, 1),
+             sizeof(TiltedReadingsHeader) + TILTED_MAX_NAME_LEN + sizeof(TiltedValueItem));
+    CHECK_EQ(tilted_encode_readings_packet(buf, sizeof(buf), 1, 1, NAME, NAME_LEN, nullptr, 1), 0);
+    CHECK_EQ(tilted_encode_readings_packet(nullptr, sizeof(buf), 1, 1, NAME, NAME_LEN, ITEMS, 1), 0);
+}
+
+static void testAppendItem()
+{
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = encodeReadings(buf, sizeof(buf));
+    const uint16_t grown = tilted_append_readings_item(buf, len, sizeof(buf), TiltedValueHelper::rssiDbm(-71));
+    CHECK_EQ(grown, len + sizeof(TiltedValueItem));
+
+    TiltedReadingsView view{};
+    CHECK(tilted_decode_readings_view(buf, grown, view));
+    CHECK_EQ(view.header.itemCount, ITEM_COUNT + 1);
+    CHECK_EQ(tilted_items(view)[ITEM_COUNT].type, (uint8_t)TiltedValueType::RssiDbm);
+    CHECK_EQ(tilted_items(view)[ITEM_COUNT].value, -71);
+
+    // No room, or not a readings frame: left alone.
+    CHECK_EQ(tilted_append_readings_item(buf, grown, grown + sizeof(TiltedValueItem) - 1, ITEMS[0]), 0);
+    CHECK_EQ(tilted_append_readings_item(buf, grown - 1, sizeof(buf), ITEMS[0]), 0);
+}
+
+static void testBatchRoundTrip()
+{
+    const TiltedBatchSet sets[] = {{1800, ITEMS, 2}, {900, ITEMS + 1, 3}, {0, ITEMS, 0}};
+    uint8_t buf[TILTED_MAX_FRAME_LEN];
+    const uint16_t len = tilted_encode_batch_packet(buf, sizeof(buf), 7, 900, NAME, NAME_LEN, sets, 3);
+    CHECK_EQ(len, tilted_batch_packet_size(NAME_LEN, sets, 3));
+
+    TiltedBatchView batch{};
+    CHECK(tilted_decode_batch_view(buf, len, batch));
+    CHECK_EQ(batch.header.itemCount, 3);
+
+    uint16_t offset = 0;
+    TiltedBatchSetView set{};
+    for (uint8_t s = 0; s < 3; s++)
+    {
+        CHECK(tilted_batch_next_set(batch, offset, set));
+        CHECK_EQ(set.ageS, sets[s].ageS);
+        CHECK_EQ(set.itemCount, sets[s].itemCount);
+        for (uint8_t i = 0; i < set.itemCount; i++)
+            CHECK_EQ(tilted_items(set)[i].value, sets[s].items[i].value);
+    }
+    CHECK(!tilted_batch_next_set(batch, offset, set));
+
+    // A v1 decoder does not take a batch, nor the other way round.
+    TiltedReadingsView view{};
+    CHECK(!tilted_decode_readings_view(buf, len, view));
+    uint8_t single[TILTED_MAX_FRAME_LEN];
+    CHECK(!tilted_decode_batch_view(single, encodeReadings(single, sizeof(single)), batch));
+}
+
+static void testBatchRejectsTruncatedAndPadded()
+{
+    const TiltedBatchSet sets[] = {{60, ITEMS, ITEM_COUNT}, {0, ITEMS, ITEM_COUNT}};
+    uint8_t buf[TILTED_MAX_FRAME_LEN + 1];
+    const uint16_t len = tilted_encode_batch_packet(buf, TILTED_MAX_FRAME_LEN, 7, 900, NAME, NAME_LEN, sets, 2);
+    CHECK(len != 0);
+
+    TiltedBatchView batch{};
+    for (uint16_t n = 0; n < len; n++)
+        CHECK(!tilted_decode_batch_view(buf, n, batch));
+    buf[len] = 0;
+    CHECK(!tilted_decode_batch_view(buf, len + 1, batch));
+
+    // No sets at all.
+    const uint16_t empty = tilted_encode_batch_packet(buf, sizeof(buf), 7, 900, NAME, NAME_LEN, sets, 0);
+    CHECK(empty == 0 || !tilted_decode_batch_view(buf, empty, batch));
+}
+
+static void testConfigRoundTrip()
+{
+    const TiltedValueItem settings[] = {
+        TiltedValueHelper::intervalS(600),
+        TiltedValueHelper::tiltDeadband(0.2f),
+    };
+    uint8_t buf[sizeof(TiltedConfigHeader) + TILTED_MAX_CONFIG_ITEMS * sizeof(TiltedValueItem) + 1];
+    const uint16_t len = tilted_encode_config_packet(buf, sizeof(buf), 0x1a2b3c4d, 42, settings, 2);
+    CHECK_EQ(len, sizeof(TiltedConfigHeader) + 2 * sizeof(TiltedValueItem));
+
+    TiltedConfigView view{};
+    CHECK(tilted_decode_config_view(buf, len, view));
+    CHECK_EQ(view.header.chipId, 0x1a2b3c4d);
+    CHECK_EQ(view.header.version, 42);
+    CHECK_EQ(tilted_items(view)[0].value, 600);
+    CHECK_NEAR(TiltedValueHelper::toFloat(tilted_items(view)[1]), 0.2, 1e-4);
+
+    for (uint16_t n = 0; n < len; n++)
+        CHECK(!tilted_decode_config_view(buf, n, view));
+    buf[len] = 0;
+    CHECK(!tilted_decode_config_view(buf, len + 1, view));
+
+    TiltedValueItem tooMany[TILTED_MAX_CONFIG_ITEMS + 1]{};
+    CHECK_EQ(tilted_encode_config_packet(buf, sizeof(buf), 1, 1, tooMany, TILTED_MAX_CONFIG_ITEMS + 1), 0);
+}
+
+static void testValueScaling()
+{
+    CHECK_EQ(TiltedValueHelper::tiltDeg(12.34f).value, 123);
+    CHECK_EQ(TiltedValueHelper::tiltDeg(12.35f).scale10, -1);
+    CHECK_EQ(TiltedValueHelper::tempC(-0.05f).value, -1);
+    CHECK_EQ(TiltedValueHelper::scaleAndRound(1.5f, 0), 2);
+    CHECK_NEAR(TiltedValueHelper::applyScale(3310.0f, -3), 3.31, 1e-6);
+    CHECK_NEAR(TiltedValueHelper::applyScale(2.0f, 3), 2000.0, 0.0);
+    CHECK(isinf(TiltedValueHelper::pow10f(TiltedValueHelper::POW10_MAX + 1)));
+}
+
+int main()
+{
+    RUN(testReadingsRoundTrip);
+    RUN(testReadingsUnaligned);
+    RUN(testReadingsRejectsTruncatedAndPadded);
+    RUN(testReadingsRejectsBadHeader);
+    RUN(testEncoderLimits);
+    RUN(testAppendItem);
+    RUN(testBatchRoundTrip);
+    RUN(testBatchRejectsTruncatedAndPadded);
+    RUN(testConfigRoundTrip);
+    RUN(testValueScaling);
+    return TEST_RESULT();
+}
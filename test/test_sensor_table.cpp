@@ -0,0 +1,215 @@
+// SensorTable (gateway/src/sensor_table.*): lookups through colliding probe
+// runs, LRU eviction once full, and backward-shift deletion keeping every
+// remaining sensor reachable, checked against a simple model.
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "sensor_table.h"
+#include "tilted_check.h"
+
+// Mirrors SensorTable::home() so tests can build collisions on purpose.
+static uint8_t homeOf(uint32_t chipId)
+{
+    return (uint8_t)((chipId * 2654435761UL) >> 27) & (SensorTable::SLOTS - 1);
+}
+
+// count ids starting from `from` that all hash to slot `home`.
+static std::vector<uint32_t> idsWithHome(uint8_t home, uint8_t count, uint32_t from = 1)
+{
+    std::vector<uint32_t> ids;
+    for (uint32_t id = from; ids.size() < count; id++)
+    {
+        if (homeOf(id) == home)
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+// ids hashing anywhere except the listed homes, so fillers stay out of the
+// probe runs under test.
+static std::vector<uint32_t> fillers(uint8_t count, std::initializer_list<uint8_t> avoid)
+{
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 0x10000000; ids.size() < count; id++)
+    {
+        bool clash = false;
+        for (uint8_t a : avoid)
+            clash = clash || ((homeOf(id) - a) & (SensorTable::SLOTS - 1)) <= 4;
+        if (!clash)
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+static void testTouchAndFind()
+{
+    SensorTable t;
+    CHECK(t.find(42) == nullptr);
+    CHECK(t.at(0) == nullptr);
+
+    SensorTable::Entry& e = t.touch(42, 1000);
+    CHECK_EQ(e.chipId, 42);
+    CHECK_EQ(e.lastSeenMs, 1000);
+    CHECK(isnan(e.tilt) && isnan(e.temp) && isnan(e.gravity));
+    CHECK_EQ(e.sequence.received(), 0);
+    e.batteryMv = 3700;
+
+    SensorTable::Entry& again = t.touch(42, 2000);
+    CHECK(&again == &e);
+    CHECK_EQ(again.lastSeenMs, 2000);
+    CHECK_EQ(again.batteryMv, 3700);
+    CHECK_EQ(t.size(), 1);
+
+    const SensorTable& ct = t;
+    CHECK(ct.find(42) == &e);
+    CHECK(ct.at(0) == &e);
+    CHECK(ct.at(1) == nullptr);
+}
+
+static void testCollidingIds()
+{
+    SensorTable t;
+    // A run of five ids sharing one home, including one that wraps past
+    // the last slot.
+    for (uint8_t home : {(uint8_t)3, (uint8_t)(SensorTable::SLOTS - 2)})
+    {
+        const std::vector<uint32_t> ids = idsWithHome(home, 5);
+        for (uint32_t id : ids)
+            t.touch(id, id).batteryMv = (int32_t)id;
+        for (uint32_t id : ids)
+        {
+            const SensorTable::Entry* e = t.find(id);
+            CHECK(e != nullptr);
+            CHECK(e && e->batteryMv == (int32_t)id);
+        }
+    }
+    CHECK_EQ(t.size(), 10);
+    CHECK_EQ(t.evictions(), 0);
+}
+
+static void testEvictsLeastRecentlySeen()
+{
+    SensorTable t;
+    const std::vector<uint32_t> ids = fillers(SensorTable::MAX_SENSORS, {});
+    for (uint32_t id : ids)
+        t.touch(id, 0);
+    CHECK_EQ(t.size(), SensorTable::MAX_SENSORS);
+
+    // Everything but ids[5] is seen again, so ids[5] is the oldest.
+    for (uint8_t i = 0; i < ids.size(); i++)
+    {
+        if (i != 5)
+            t.touch(ids[i], 1);
+    }
+    t.touch(7, 2);
+    CHECK_EQ(t.size(), SensorTable::MAX_SENSORS);
+    CHECK_EQ(t.evictions(), 1);
+    CHECK(t.find(ids[5]) == nullptr);
+    CHECK(t.find(7) != nullptr);
+
+    // find() is not a use: ids[0] stays the oldest of the rest.
+    t.find(ids[0]);
+    t.touch(8, 3);
+    CHECK(t.find(ids[0]) == nullptr);
+    CHECK_EQ(t.evictions(), 2);
+
+    uint8_t live = 0;
+    while (t.at(live))
+        live++;
+    CHECK_EQ(live, SensorTable::MAX_SENSORS);
+}
+
+static void testBackwardShiftDelete()
+{
+    // Three ids in one probe run; evicting the first must pull the others
+    // back so neither is lost behind the hole.
+    for (uint8_t home : {(uint8_t)10, (uint8_t)(SensorTable::SLOTS - 1)})
+    {
+        SensorTable t;
+        const std::vector<uint32_t> run = idsWithHome(home, 3);
+        // One id homed right after the run's start, displaced past the run;
+        // the shift must not move it in front of its own home.
+        const std::vector<uint32_t> neighbour = idsWithHome((uint8_t)((home + 1) & (SensorTable::SLOTS - 1)), 1);
+        for (uint32_t id : run)
+            t.touch(id, 0);
+        t.touch(neighbour[0], 0);
+
+        for (uint32_t id : fillers(SensorTable::MAX_SENSORS - 4, {home, (uint8_t)((home + 1) & (SensorTable::SLOTS - 1))}))
+            t.touch(id, 1);
+        t.touch(run[1], 1);
+        t.touch(run[2], 1);
+        t.touch(neighbour[0], 1);
+        CHECK_EQ(t.size(), SensorTable::MAX_SENSORS);
+
+        t.touch(0xABCDEF01, 2); // evicts run[0]
+        CHECK_EQ(t.evictions(), 1);
+        CHECK(t.find(run[0]) == nullptr);
+        CHECK(t.find(run[1]) != nullptr);
+        CHECK(t.find(run[2]) != nullptr);
+        CHECK(t.find(neighbour[0]) != nullptr);
+        CHECK(t.find(0xABCDEF01) != nullptr);
+    }
+}
+
+// Random touches against a model that keeps ids in recency order; after
+// every step the table must hold exactly the model's ids.
+static void testAgainstModel()
+{
+    SensorTable t;
+    std::vector<uint32_t> model; // least recently seen first
+    std::mt19937 rng(1234);
+    // 40 distinct ids over 32 slots: probe runs collide, and ids come back
+    // after being evicted.
+    std::uniform_int_distribution<uint32_t> pick(1, 40);
+    uint32_t evictions = 0;
+
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        const uint32_t id = pick(rng) * 0x01000193u;
+        t.touch(id, step);
+
+        auto it = std::find(model.begin(), model.end(), id);
+        if (it != model.end())
+        {
+            model.erase(it);
+        }
+        else if (model.size() == SensorTable::MAX_SENSORS)
+        {
+            model.erase(model.begin());
+            evictions++;
+        }
+        model.push_back(id);
+
+        if (t.size() != model.size())
+        {
+            CHECK_EQ(t.size(), model.size());
+            return;
+        }
+        for (uint32_t m : model)
+        {
+            if (!t.find(m))
+            {
+                fprintf(stderr, "  step %u: %08x missing\n", (unsigned)step, (unsigned)m);
+                CHECK(t.find(m) != nullptr);
+                return;
+            }
+        }
+    }
+    CHECK_EQ(t.evictions(), evictions);
+    CHECK(evictions > 0);
+}
+
+int main()
+{
+    RUN(testTouchAndFind);
+    RUN(testCollidingIds);
+    RUN(testEvictsLeastRecentlySeen);
+    RUN(testBackwardShiftDelete);
+    RUN(testAgainstModel);
+    return TEST_RESULT();
+}
@@ -0,0 +1,115 @@
+// SequenceWindow (gateway/src/sequence_window.h): duplicates, late
+// arrivals, gaps wider than the window, sensor restarts and counter
+// wraparound, and that seen() agrees with accept() without recording.
+
+#include <stdint.h>
+
+#include "sequence_window.h"
+#include "tilted_check.h"
+
+// seen() must predict accept() exactly and leave the window untouched.
+static bool acceptChecked(SequenceWindow& w, uint32_t seq)
+{
+    const bool wasSeen = w.seen(seq);
+    CHECK(w.seen(seq) == wasSeen);
+    const bool accepted = w.accept(seq);
+    CHECK(accepted == !wasSeen);
+    return accepted;
+}
+
+static void testInOrderAndDuplicates()
+{
+    SequenceWindow w;
+    CHECK(!w.seen(1));
+    for (uint32_t s = 1; s <= 5; s++)
+        CHECK(acceptChecked(w, s));
+    CHECK(!acceptChecked(w, 5));
+    CHECK(!acceptChecked(w, 3));
+    CHECK_EQ(w.newest(), 5);
+    CHECK_EQ(w.received(), 5);
+    CHECK_EQ(w.duplicates(), 2);
+    CHECK_EQ(w.lost(), 0);
+    CHECK_NEAR(w.lossPercent(), 0.0, 0.0);
+}
+
+static void testGapsAndLateArrivals()
+{
+    SequenceWindow w;
+    CHECK(acceptChecked(w, 10));
+    CHECK(acceptChecked(w, 14)); // 11..13 missing
+    CHECK_EQ(w.lost(), 3);
+    CHECK(acceptChecked(w, 12)); // turns up late
+    CHECK_EQ(w.lost(), 2);
+    CHECK(!acceptChecked(w, 12));
+    CHECK(!acceptChecked(w, 10));
+    CHECK_EQ(w.received(), 3);
+    CHECK_NEAR(w.lossPercent(), 40.0, 1e-4);
+
+    // 14 moves to the oldest position the window still remembers.
+    CHECK(acceptChecked(w, 14 + SequenceWindow::WINDOW - 1));
+    CHECK(!acceptChecked(w, 14));
+}
+
+static void testGapWiderThanWindow()
+{
+    SequenceWindow w;
+    CHECK(acceptChecked(w, 5));
+    CHECK(acceptChecked(w, 6));
+    CHECK(acceptChecked(w, 6 + 100));
+    CHECK_EQ(w.lost(), 99);
+    CHECK(!acceptChecked(w, 106));
+    // Inside the new window but never seen: a late arrival.
+    CHECK(acceptChecked(w, 106 - SequenceWindow::WINDOW + 1));
+    CHECK_EQ(w.lost(), 98);
+}
+
+static void testRestart()
+{
+    SequenceWindow w;
+    for (uint32_t s = 1; s <= 40; s++)
+        w.accept(s);
+
+    // Power loss: the sensor counts from 1 again, even though 1 is far
+    // behind the newest number, and the window follows it.
+    CHECK(acceptChecked(w, 1));
+    CHECK_EQ(w.newest(), 1);
+    CHECK(acceptChecked(w, 2));
+    CHECK(!acceptChecked(w, 2));
+
+    // Anything older than the window is taken as a restart, not a duplicate.
+    SequenceWindow v;
+    v.accept(100);
+    CHECK(acceptChecked(v, 100 - SequenceWindow::WINDOW));
+    CHECK_EQ(v.newest(), 100 - SequenceWindow::WINDOW);
+    CHECK_EQ(v.duplicates(), 0);
+}
+
+static void testWraparound()
+{
+    SequenceWindow w;
+    CHECK(acceptChecked(w, 0xFFFFFFFEu));
+    CHECK(acceptChecked(w, 0xFFFFFFFFu));
+    CHECK(!acceptChecked(w, 0xFFFFFFFFu));
+    // The counter wraps: 0 and 1 start over rather than being dropped.
+    CHECK(acceptChecked(w, 0));
+    CHECK_EQ(w.newest(), 0);
+    CHECK(acceptChecked(w, 1));
+    CHECK(!acceptChecked(w, 0));
+    CHECK_EQ(w.duplicates(), 2);
+
+    SequenceWindow v;
+    v.accept(0xFFFFFFFFu);
+    CHECK(acceptChecked(v, 1));
+    CHECK_EQ(v.newest(), 1);
+    CHECK_EQ(v.lost(), 0);
+}
+
+int main()
+{
+    RUN(testInOrderAndDuplicates);
+    RUN(testGapsAndLateArrivals);
+    RUN(testGapWiderThanWindow);
+    RUN(testRestart);
+    RUN(testWraparound);
+    return TEST_RESULT();
+}
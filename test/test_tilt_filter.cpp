@@ -0,0 +1,104 @@
+// TiltFilter (sensor/src/tilt_filter.h): median, spread and the MAD-trimmed
+// mean, and that cached results follow add()/clear() and a changed k.
+
+#include <math.h>
+
+#include "tilt_filter.h"
+#include "tilted_check.h"
+
+static void testEmpty()
+{
+    TiltFilter<4> f;
+    CHECK_EQ(f.count(), 0);
+    CHECK(isnan(f.median()));
+    CHECK(isnan(f.spread()));
+    CHECK(isnan(f.madMean(3.0f)));
+}
+
+static void testMedianOddAndEven()
+{
+    TiltFilter<8> f;
+    for (float v : {5.0f, 1.0f, 4.0f})
+        f.add(v);
+    CHECK_NEAR(f.median(), 4.0, 0.0);
+    CHECK_NEAR(f.spread(), 4.0, 0.0);
+
+    f.add(2.0f); // 1 2 4 5
+    CHECK_NEAR(f.median(), 3.0, 0.0);
+    CHECK_NEAR(f.spread(), 4.0, 0.0);
+
+    f.clear();
+    f.add(7.5f);
+    CHECK_NEAR(f.median(), 7.5, 0.0);
+    CHECK_NEAR(f.spread(), 0.0, 0.0);
+}
+
+static void testFullWindow()
+{
+    TiltFilter<3> f;
+    CHECK(f.add(1.0f));
+    CHECK(f.add(2.0f));
+    CHECK(f.add(3.0f));
+    CHECK(f.full());
+    CHECK(!f.add(100.0f));
+    CHECK_EQ(f.count(), 3);
+    CHECK_NEAR(f.median(), 2.0, 0.0);
+    CHECK_NEAR(f.spread(), 2.0, 0.0);
+}
+
+static void testMadMeanRejectsOutliers()
+{
+    TiltFilter<8> f;
+    for (float v : {10.0f, 10.2f, 9.8f, 10.0f, 30.0f, 10.1f, 9.9f})
+        f.add(v);
+    // Median 10, MAD 0.1: only the knocked 30 is outside 3 * 1.4826 * 0.1.
+    CHECK_NEAR(f.median(), 10.0, 1e-6);
+    CHECK_NEAR(f.madMean(3.0f), 10.0, 1e-5);
+    // A wide enough limit keeps everything.
+    CHECK_NEAR(f.madMean(1000.0f), 90.0 / 7.0, 1e-4);
+    // k <= 0 is the median.
+    CHECK_NEAR(f.madMean(0.0f), 10.0, 1e-6);
+    CHECK_NEAR(f.madMean(-1.0f), 10.0, 1e-6);
+}
+
+static void testMadMeanZeroMad()
+{
+    // More than half the samples agree exactly, so the MAD is 0 and only
+    // those samples are kept.
+    TiltFilter<8> f;
+    for (float v : {20.0f, 20.0f, 20.0f, 21.0f, 19.0f})
+        f.add(v);
+    CHECK_NEAR(f.madMean(3.0f), 20.0, 0.0);
+}
+
+static void testCacheFollowsChanges()
+{
+    TiltFilter<8> f;
+    for (float v : {1.0f, 2.0f, 3.0f, 4.0f, 100.0f})
+        f.add(v);
+    const float trimmed = f.madMean(2.0f);
+    CHECK_NEAR(trimmed, 2.5, 1e-6);
+    CHECK_NEAR(f.madMean(2.0f), trimmed, 0.0);
+    CHECK_NEAR(f.madMean(1000.0f), 22.0, 1e-5); // new k, not the cached value
+    CHECK_NEAR(f.madMean(2.0f), trimmed, 0.0);
+
+    f.add(3.0f); // 1 2 3 3 4 100: same k, new samples
+    CHECK_NEAR(f.median(), 3.0, 0.0);
+    CHECK_NEAR(f.madMean(2.0f), 13.0 / 5.0, 1e-6);
+
+    f.clear();
+    CHECK(isnan(f.madMean(2.0f)));
+    f.add(5.0f);
+    CHECK_NEAR(f.madMean(2.0f), 5.0, 0.0);
+}
+
+int main()
+{
+    RUN(testEmpty);
+    RUN(testMedianOddAndEven);
+    RUN(testFullWindow);
+    RUN(testMadMeanRejectsOutliers);
+    RUN(testMadMeanZeroMad);
+    RUN(testCacheFollowsChanges);
+    return TEST_RESULT();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Minimal checks for the host tests, so they need nothing beyond a compiler.
+//
+// Usage:
+//   static void testSomething() { CHECK(x); CHECK_EQ(a, b); }
+//   int main() { RUN(testSomething); return TEST_RESULT(); }
+
+#include <math.h>
+#include <stdio.h>
+
+inline int tilted_check_failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(cond))                                                                      \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);     \
+            tilted_check_failures++;                                                      \
+        }                                                                                 \
+    } while (0)
+
+// Integral values only; both sides are printed on failure.
+#define CHECK_EQ(a, b)                                                                    \
+    do                                                                                    \
+    {                                                                                     \
+        const long long va_ = (long long)(a);                                             \
+        const long long vb_ = (long long)(b);                                             \
+        if (va_ != vb_)                                                                   \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__,   \
+                    __LINE__, #a, #b, va_, vb_);                                          \
+            tilted_check_failures++;                                                      \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                                             \
+    do                                                                                    \
+    {                                                                                     \
+        const double va_ = (double)(a);                                                   \
+        const double vb_ = (double)(b);                                                   \
+        if (!(fabs(va_ - vb_) <= (eps)))                                                  \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__,     \
+                    __LINE__, #a, #b, va_, vb_);                                          \
+            tilted_check_failures++;                                                      \
+        }                                                                                 \
+    } while (0)
+
+// Flushes the name first so failures (on stderr) print under their test.
+#define RUN(test)                   \
+    do                              \
+    {                               \
+        printf("%s\n", #test);      \
+        fflush(stdout);             \
+        test();                     \
+    } while (0)
+
+#define TEST_RESULT() (tilted_check_failures == 0 ? 0 : (fprintf(stderr, "%d check(s) failed\n", tilted_check_failures), 1))